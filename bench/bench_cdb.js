@@ -0,0 +1,83 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+//
+// Put/get throughput in a transactional env (the default) vs. a Concurrent
+// Data Store env (cdb: true).  Same keys, same thread pool, same number of
+// ops in flight; only the env differs.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('../test/helper');
+
+var OPS = 20000;
+var IN_FLIGHT = 64;
+var THREADS = 4;
+
+var keys = [];
+var vals = [];
+for (var i = 0; i < OPS; i++) {
+  keys.push(new Buffer(helper.uuid()));
+  vals.push(new Buffer(helper.uuid()));
+}
+
+// Issues op(i, done) for every i in [0, OPS), IN_FLIGHT at a time
+function drive(op, callback) {
+  var next = 0;
+  var finished = 0;
+  var started = Date.now();
+
+  function issue() {
+    var i = next++;
+    op(i, function(res) {
+      assert.equal(0, res.code, res.message);
+      if (++finished === OPS)
+        return callback(Math.round(OPS / ((Date.now() - started) / 1000)));
+      if (next < OPS)
+        issue();
+    });
+  }
+
+  for (var j = 0; j < IN_FLIGHT && j < OPS; j++)
+    issue();
+}
+
+function run(name, envOptions, callback) {
+  var env = new bdb.DbEnv();
+  var location = '/tmp/' + helper.uuid();
+  fs.mkdirSync(location, 0750);
+  envOptions.home = location;
+  var stat = env.openSync(envOptions);
+  assert.equal(0, stat.code, stat.message);
+  stat = env.setThreadPool({threads: THREADS});
+  assert.equal(0, stat.code, stat.message);
+
+  var db = new bdb.Db(env);
+  stat = db.openSync({file: helper.uuid()});
+  assert.equal(0, stat.code, stat.message);
+
+  drive(function(i, done) {
+    db.put({key: keys[i], val: vals[i]}, done);
+  }, function(puts) {
+    drive(function(i, done) {
+      db.get({key: keys[i]}, done);
+    }, function(gets) {
+      console.log(name + ': ' + puts + ' puts/s, ' + gets + ' gets/s');
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      exec('rm -fr ' + location, function(err, stdout, stderr) {
+        callback(puts, gets);
+      });
+    });
+  });
+}
+
+run('txn', {}, function(txnPuts, txnGets) {
+  run('cdb', {cdb: true}, function(cdbPuts, cdbGets) {
+    console.log('cdb/txn: ' + (cdbPuts / txnPuts).toFixed(2) + 'x puts, ' +
+                (cdbGets / txnGets).toFixed(2) + 'x gets');
+  });
+});
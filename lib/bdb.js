@@ -1,8 +1,14 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 var bindings = require('../build/default/bdb_bindings');
+var BufferPool = require('./buffer_pool').BufferPool;
+var Cursor = require('./cursor').Cursor;
 var Db = require('./db').Db;
 var DbEnv = require('./env').DbEnv;
+var Txn = require('./txn').Txn;
 
+exports.BufferPool = BufferPool;
+exports.Cursor = Cursor;
 exports.Db = Db;
 exports.DbEnv = DbEnv;
+exports.Txn = Txn;
 exports.FLAGS = bindings;
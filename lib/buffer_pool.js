@@ -0,0 +1,54 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var Buffer = require('buffer').Buffer;
+
+/**
+ * A free list of same-sized Buffers, for use with db.getInto()
+ *
+ * Optional:
+ * - 'size'  Size of each Buffer, in bytes.  Default is 4096.
+ * - 'max'   Most Buffers to keep around once released.  Default is 1024.
+ *
+ * @param {Object} options
+ * @api public
+ */
+function BufferPool(options) {
+  this.size = 4096;
+  this.max = 1024;
+  if (options) {
+    if (options.size) {
+      this.size = options.size;
+    }
+    if (options.max) {
+      this.max = options.max;
+    }
+  }
+  this._free = [];
+}
+
+/**
+ * Get a Buffer of at least pool.size bytes
+ *
+ * @api public
+ */
+BufferPool.prototype.acquire = function() {
+  if (this._free.length > 0) {
+    return this._free.pop();
+  }
+  return new Buffer(this.size);
+};
+
+/**
+ * Hand a Buffer back.  Buffers of the wrong size (e.g., one you grew after
+ * a DB_BUFFER_SMALL), or past 'max', are left for the GC.
+ *
+ * @param {Buffer} buffer
+ * @api public
+ */
+BufferPool.prototype.release = function(buffer) {
+  if (buffer && buffer.length === this.size &&
+      this._free.length < this.max) {
+    this._free.push(buffer);
+  }
+};
+
+exports.BufferPool = BufferPool;
@@ -0,0 +1,118 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var Buffer = require('buffer').Buffer;
+var BDB = require('../build/default/bdb_bindings');
+var Cursor = BDB.Cursor;
+
+var EMPTY = new Buffer(0);
+
+/**
+ * Turns a packed (buffer, offsets) result into an Array of
+ * {key: Buffer, value: Buffer} records.  The Buffers are slices of the
+ * packed buffer, so nothing is copied.
+ *
+ * @param {Buffer} buffer
+ * @param {Array} offsets [keyOffset, keyLength, valOffset, valLength]...
+ * @api public
+ */
+function unpack(buffer, offsets) {
+  var records = [];
+  var i;
+  for (i = 0; i + 3 < offsets.length; i += 4) {
+    records.push({
+      key: buffer.slice(offsets[i], offsets[i] + offsets[i + 1]),
+      value: buffer.slice(offsets[i + 2], offsets[i + 2] + offsets[i + 3])
+    });
+  }
+  return records;
+}
+
+function wrap(callback) {
+  return function(res, buffer, offsets) {
+    return callback(res, unpack(buffer, offsets));
+  };
+}
+
+
+/**
+ * Read the next count records
+ *
+ * On a cursor that hasn't been positioned yet, this starts at the first
+ * record.  The callback gets (res, records); res.code is DB_NOTFOUND once
+ * the end of the database is hit (records may still hold the tail).
+ *
+ * @param {Number} count (Optional, default 1)
+ * @param {Function} callback
+ * @api public
+ */
+Cursor.prototype.next = function(count, callback) {
+  if ((typeof count) === 'function') {
+    callback = count;
+    count = 1;
+  }
+  return this._get(EMPTY, count || 1, 0, BDB.DB_NEXT, wrap(callback));
+};
+
+
+/**
+ * Read the previous count records
+ *
+ * On a cursor that hasn't been positioned yet, this starts at the last
+ * record.
+ *
+ * @param {Number} count (Optional, default 1)
+ * @param {Function} callback
+ * @api public
+ */
+Cursor.prototype.prev = function(count, callback) {
+  if ((typeof count) === 'function') {
+    callback = count;
+    count = 1;
+  }
+  return this._get(EMPTY, count || 1, 0, BDB.DB_PREV, wrap(callback));
+};
+
+
+/**
+ * Position the cursor at key
+ *
+ * Returns the record the cursor landed on.
+ *
+ * Optional:
+ * - 'exact'   If true, only an exact match (DB_SET) will do.  The default
+ *             is the smallest key >= key (DB_SET_RANGE).
+ *
+ * @param {Buffer} key
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Cursor.prototype.seek = function(key, options, callback) {
+  var initFlag = BDB.DB_SET_RANGE;
+  if ((typeof options) === 'function') {
+    callback = options;
+    options = undefined;
+  }
+  if (!key) {
+    throw new Error('key required');
+  }
+  if (options && options.exact) {
+    initFlag = BDB.DB_SET;
+  }
+  return this._get(key, 1, initFlag, BDB.DB_NEXT, wrap(callback));
+};
+
+
+/**
+ * Close the cursor, and commit its transaction (if it has one)
+ *
+ * In a 'cdb' env this is also what lets writes held for the cursor run
+ * (see Db.prototype.cursor).
+ *
+ * @api public
+ */
+Cursor.prototype.closeSync = function() {
+  return this._closeSync();
+};
+
+exports.Cursor = Cursor;
+exports.unpack = unpack;
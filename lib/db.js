@@ -1,24 +1,84 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 var Buffer = require('buffer').Buffer;
 var BDB = require('../build/default/bdb_bindings');
+var Cursor = require('./cursor').Cursor;
+var ReadStream = require('./stream').ReadStream;
 var Db = BDB.Db;
 
+// Flags for a read's own transaction: DB_READ_(UN)COMMITTED for an
+// 'isolation' (the read then runs without one), or else DB_TXN_SNAPSHOT
+// if the read asks for it (or the database was opened with 'snapshot' and
+// the read doesn't say)
+function readTxnFlags(db, options) {
+  var snapshot = db._snapshot;
+  if (options && options.isolation) {
+    if (options.isolation === 'uncommitted') {
+      return BDB.DB_READ_UNCOMMITTED;
+    } else if (options.isolation === 'committed') {
+      return BDB.DB_READ_COMMITTED;
+    }
+    throw new Error('options.isolation must be uncommitted or committed');
+  }
+  if (options && options.snapshot !== undefined) {
+    snapshot = options.snapshot;
+  }
+  return snapshot ? BDB.DB_TXN_SNAPSHOT : 0;
+}
+
 /**
  * Open a database
  *
  * Required:
  *
- * - 'file'  The Database file, given as a string
+ * - 'file'  The Database file, given as a string (or 'inMemory')
  *
  * Optional:
  * - 'type'    BDB Database Type (i.e., BTREE, HASH, ...). Default DB_BTREE
  * - 'flags'   Bitwise OR'd BDB flags. Defaults are:
- *               - DB_AUTO_COMMIT
+ *               - DB_AUTO_COMMIT (dropped if the env has no transactions)
  *               - DB_CREATE
  *               - DB_THREAD
  * - 'mode'    Unix File Permissions to set. Default is 0660.
  * - 'retries' if transactional DS, retry this many times if a DB_LOCK_DEADLOCK
  *             is encountered. Default is 1.
+ * - 'pageSize' Page size in bytes (512 - 64K, a power of 2).  Only takes
+ *             effect when the database is created.  Default is BDB's pick.
+ * - 'minKey'  (BTREE) Minimum keys per page; bigger records go to overflow
+ *             pages.  Default is 2.
+ * - 'compress' (BTREE) true for BDB's built-in prefix compression, which
+ *             pays off when keys share long prefixes.  Or
+ *             {lib: '/path/to/codec.so', compress: 'sym', decompress: 'sym'}
+ *             to plug in your own (see DB->set_bt_compress()).  Only takes
+ *             effect when the database is created.  Default is off.
+ * - 'multiversion' Open with DB_MULTIVERSION, so transactions begun with
+ *             DB_TXN_SNAPSHOT read from a snapshot (copies of pages in the
+ *             cache) instead of taking read locks.  Readers then never
+ *             block writers or deadlock with them; give the cache room
+ *             for the extra page versions.  Needs a transactional env.
+ *             Default is false.
+ * - 'snapshot' Implies 'multiversion', and makes snapshot isolation the
+ *             default for reads that get their own transaction (get*,
+ *             cursorGet*, cursor()); any read can still say otherwise
+ *             with its own 'snapshot' option.  Default is false.
+ * - 'readUncommitted' Open with DB_READ_UNCOMMITTED, which reads with
+ *             isolation: 'uncommitted' need.  Default is false.
+ * - 'inMemory' No 'file': the database lives in the env's cache (and
+ *             goes away when it's closed).  Best paired with an inMemory
+ *             env.  Default is false.
+ *
+ * - 'ffactor' (HASH) Target keys per bucket; past it, buckets split.
+ *             Default is to pick one as pages fill up.
+ * - 'nelem'   (HASH) Expected number of keys.  Sizes the table up front,
+ *             so a bulk load doesn't split its way there.  Default is 0
+ *             (start small and grow).
+ * - 'hash'    (HASH) true for our word-at-a-time hash instead of BDB's
+ *             byte-at-a-time one, or {lib: '/path/to/hash.so', sym: 'sym'}
+ *             to plug in your own (see DB->set_h_hash()).  A database has
+ *             to be opened with the same hash every time: BDB doesn't
+ *             check, it just won't find anything.  Default is BDB's.
+ *
+ * Note that BTREE has no fill factor to set; BDB splits pages as needed.
+ * ffactor, nelem and hash only take effect when the database is created.
  *
  * @param {Object} options
  * @api public
@@ -28,10 +88,11 @@ Db.prototype.openSync = function(options) {
   var flags = BDB.DB_AUTO_COMMIT | BDB.DB_CREATE | BDB.DB_THREAD;
   var mode = 0;
   var retries = 1;
+  var stat;
   if (!options) {
     throw new Error('options required');
   }
-  if (!options.file) {
+  if (!options.file && !options.inMemory) {
     throw new Error('options.file required');
   }
   if (options.type) {
@@ -46,13 +107,71 @@ Db.prototype.openSync = function(options) {
   if (options.retries) {
     retries = options.retries;
   }
-  return this._openSync(options.file, type, flags, mode, retries);
+  if (options.multiversion || options.snapshot) {
+    flags |= BDB.DB_MULTIVERSION;
+  }
+  if (options.readUncommitted) {
+    flags |= BDB.DB_READ_UNCOMMITTED;
+  }
+  this._snapshot = options.snapshot ? true : false;
+  if (options.pageSize) {
+    stat = this.setPageSize(options.pageSize);
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  if (options.minKey) {
+    stat = this.setBtMinKey(options.minKey);
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  if (options.compress) {
+    if (options.compress === true) {
+      stat = this.setBtCompress();
+    } else {
+      stat = this.setBtCompress(options.compress.lib,
+                                options.compress.compress,
+                                options.compress.decompress);
+    }
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  if (options.ffactor) {
+    stat = this.setHFfactor(options.ffactor);
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  if (options.nelem) {
+    stat = this.setHNelem(options.nelem);
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  if (options.hash) {
+    if (options.hash === true) {
+      stat = this.setHHash();
+    } else {
+      stat = this.setHHash(options.hash.lib, options.hash.sym);
+    }
+    if (stat.code !== 0) {
+      return stat;
+    }
+  }
+  return this._openSync(options.inMemory ? null : options.file, type, flags,
+                        mode, retries);
 };
 
 
 /**
  * Close a database
  *
+ * Group-commit puts still waiting for their window are written first
+ * (their callbacks run afterwards, as usual), and a group already being
+ * written is waited for.
+ *
  * Optional:
  * - 'flags'   Bitwise OR'd BDB flags. Default is 0.
  *
@@ -70,6 +189,231 @@ Db.prototype.closeSync = function(options) {
 };
 
 
+/**
+ * Turn on (or off) group commit
+ *
+ * With group commit on, put() calls that don't name a txn are queued for
+ * up to 'window' microseconds (or until 'maxOps' are waiting), then all
+ * written in one transaction that commits -- and syncs the log -- once.
+ * Each callback fires after that shared commit, so a put is exactly as
+ * durable as before; you just pay for one log flush per group instead of
+ * one per put.  A put that fails on its own (e.g., DB_KEYEXIST) doesn't
+ * affect the rest of its group, but a group that can't commit fails every
+ * put in it.
+ *
+ * Only applies to transactional databases.
+ *
+ * Optional:
+ * - 'maxOps'  Flush once this many puts are queued.  0 or 1 turns group
+ *             commit off.  Default is 64.
+ * - 'window'  Longest a put waits for company, in microseconds.
+ *             Default is 1000.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.setGroupCommit = function(options) {
+  var maxOps = 64;
+  var usecs = 1000;
+  if (options) {
+    if (options.maxOps !== undefined) {
+      maxOps = options.maxOps;
+    }
+    if (options.window !== undefined) {
+      usecs = options.window;
+    }
+  }
+  return this._setGroupCommit(maxOps, usecs);
+};
+
+
+/**
+ * Serialize writes to the same key before they reach BDB
+ *
+ * Concurrent writes to a hot key mostly end up deadlocking in BDB and
+ * being retried.  With a key gate, put()/putRange()/putIf()/del() calls
+ * that don't name a txn hash their key to one of 'stripes' slots, and
+ * only one write per slot is handed to BDB at a time; the rest wait,
+ * in the order they were made.  Writes to different slots still run in
+ * parallel.  Puts that go through group commit, and the *Sync calls,
+ * aren't gated.
+ *
+ * With 'merge', a plain put (no flags) that finds an older plain put to
+ * the same key still waiting replaces it: only the newest value is
+ * written, and both callbacks get its status.  Not for databases with
+ * duplicates, where it's skipped.
+ *
+ * Can only be set once.
+ *
+ * Optional:
+ * - 'stripes'  Number of slots.  More means fewer unrelated keys waiting
+ *              on each other.  Default is 256.
+ * - 'merge'    Last writer wins for queued puts.  Default is false.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.setKeyGate = function(options) {
+  var stripes = 256;
+  var merge = 0;
+  if (options) {
+    if (options.stripes !== undefined) {
+      stripes = options.stripes;
+    }
+    if (options.merge) {
+      merge = 1;
+    }
+  }
+  return this._setKeyGate(stripes, merge);
+};
+
+
+/**
+ * How to retry auto-commit operations that lose a deadlock
+ *
+ * By default a deadlocked operation is retried straight away, up to
+ * openSync()'s 'retries' times.  Under real contention that just makes
+ * the same transactions collide again, so instead each retry can wait a
+ * little longer than the last: 'base', then twice that, and so on up to
+ * 'max', with some jitter so the losers don't all come back together.
+ * With 'defer', async operations wait out the delay on a timer and go
+ * back on the queue, rather than sleeping in a worker thread.
+ *
+ * Operations in a caller's txn are never retried; the deadlock is handed
+ * back for the caller to abort.  See retryStats() for how often this
+ * happens.
+ *
+ * Optional:
+ * - 'retries'  Most retries per operation.  Default is what openSync()
+ *              was given.
+ * - 'base'     Delay before the first retry, in microseconds.  0 just
+ *              yields the CPU.  Default is 0.
+ * - 'max'      Longest delay between retries, in microseconds.  0 is no
+ *              cap.  Default is 0.
+ * - 'timeout'  Give up once an operation has been retrying this long, in
+ *              microseconds, whatever 'retries' says.  Default is 0 (none).
+ * - 'defer'    Wait on the event loop instead of a worker.  Default is
+ *              false.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.setRetryPolicy = function(options) {
+  var retries = -1;
+  var base = 0;
+  var max = 0;
+  var timeout = 0;
+  var defer = 0;
+  if (options) {
+    if (options.retries !== undefined) {
+      retries = options.retries;
+    }
+    if (options.base !== undefined) {
+      base = options.base;
+    }
+    if (options.max !== undefined) {
+      max = options.max;
+    }
+    if (options.timeout !== undefined) {
+      timeout = options.timeout;
+    }
+    if (options.defer) {
+      defer = 1;
+    }
+  }
+  return this._setRetryPolicy(retries, base, max, timeout, defer);
+};
+
+
+/**
+ * Compress values with a native codec
+ *
+ * Values are compressed (and decompressed) on the worker threads, inside
+ * every put/get/cursor path, using a shared library you supply (a thin
+ * shim over LZ4, zstd, ...; see src/bdb_codec.h for the exports it
+ * needs).  Compressed values are tagged with a short header (0xf5 'BDC'
+ * plus a version byte); values that don't shrink are stored untagged,
+ * and untagged values read back unchanged.  So a codec can be added to a
+ * database that already has data, as long as none of its values happen
+ * to start with that header.
+ *
+ * Set the codec before openSync(), and use the same codec (and
+ * dictionary) every time the database is opened from then on.
+ * getRange()/putRange() can't be used on a compressed database, and
+ * neither can _associateSync() (the secondary-key callback would be
+ * handed compressed values).
+ *
+ * Required:
+ * - 'lib'         Path to the codec library
+ * - 'prefix'      Prefix of its exported functions
+ *
+ * Optional:
+ * - 'dictionary'  Buffer from trainCodec(), for small values
+ * - 'minSize'     Values shorter than this aren't compressed.  Default
+ *                 is 64.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.setCodec = function(options) {
+  var minSize = 64;
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.lib) {
+    throw new Error('options.lib required');
+  }
+  if (!options.prefix) {
+    throw new Error('options.prefix required');
+  }
+  if (options.minSize !== undefined) {
+    minSize = options.minSize;
+  }
+  return this._setCodec(options.lib, options.prefix,
+                        options.dictionary || null, minSize);
+};
+
+
+/**
+ * Train a compression dictionary
+ *
+ * Small values don't compress well on their own; a dictionary built from
+ * typical values fixes that.  Returns the dictionary as a Buffer; keep it
+ * somewhere safe and pass it to setCodec() on every open.  Runs
+ * synchronously.
+ *
+ * Required:
+ * - 'lib'      Path to the codec library (which must export _train)
+ * - 'prefix'   Prefix of its exported functions
+ * - 'samples'  Array of sample values (Buffers)
+ *
+ * Optional:
+ * - 'size'     Largest dictionary to build, in bytes.  Default is 16KB.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.trainCodec = function(options) {
+  var size = 16384;
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.lib) {
+    throw new Error('options.lib required');
+  }
+  if (!options.prefix) {
+    throw new Error('options.prefix required');
+  }
+  if (!options.samples || !Array.isArray(options.samples)) {
+    throw new Error('options.samples (Array) required');
+  }
+  if (options.size) {
+    size = options.size;
+  }
+  return this._trainCodec(options.lib, options.prefix, options.samples, size);
+};
+
+
 /**
  * DB Put wrapper
  *
@@ -80,6 +424,9 @@ Db.prototype.closeSync = function(options) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own (or a shared one, see
+ *             setGroupCommit()).
  *
  * @param {Object} options
  * @param {Function} callback
@@ -99,7 +446,51 @@ Db.prototype.put = function(options, callback) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._put(options.key, options.val, flags, callback);
+  return this._put(options.txn, options.key, options.val, flags, callback);
+};
+
+
+/**
+ * DB Put wrapper for part of a value (DB_DBT_PARTIAL)
+ *
+ * Overwrites val.length bytes of the stored value starting at 'offset',
+ * and only touches the pages involved.  Writing past the end extends the
+ * value (any gap is zero-filled), so offset == current length appends.
+ * A missing key is created.
+ *
+ * Required:
+ * - 'key'     Database key to update (Buffer)
+ * - 'offset'  Byte offset into the value
+ * - 'val'     Bytes to write there (Buffer)
+ *
+ * Optional:
+ * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.putRange = function(options, callback) {
+  var flags = 0;
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.key) {
+    throw new Error('options.key required');
+  }
+  if ((typeof options.offset) !== 'number') {
+    throw new Error('options.offset (Number) required');
+  }
+  if (!options.val) {
+    throw new Error('options.val required');
+  }
+  if (options.flags) {
+    flags = options.flags;
+  }
+  return this._putRange(options.txn, options.key, options.offset,
+                        options.val, flags, callback);
 };
 
 
@@ -114,9 +505,13 @@ Db.prototype.put = function(options, callback) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
  *
- * Note that this API doesn't exist in core BDB. I just added it so that
- * one can work around the lack of transactions in node.js bindings.
+ * Note that this API doesn't exist in core BDB. It predates Txn support,
+ * and is still handy when a compare-and-swap is all you need.  In a 'cdb'
+ * env there are no transactions, so it runs on a DB_WRITECURSOR instead
+ * (and 'flags' is ignored).
  *
  * @param {Object} options
  * @param {Function} callback
@@ -139,7 +534,68 @@ Db.prototype.putIf = function(options, callback) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._putIf(options.key, options.val, options.oldVal, flags, callback);
+  return this._putIf(options.txn, options.key, options.val, options.oldVal,
+                    flags, callback);
+};
+
+
+/**
+ * DB Bulk Put wrapper
+ *
+ * Writes every record in one native request, under one transaction.
+ *
+ * Required:
+ * - 'records' Array of {key: Buffer, val: Buffer} objects
+ *
+ * Optional:
+ * - 'flags'     Optional Flags: Default is 0
+ * - 'perRecord' If true, records are put one at a time (still in one
+ *               transaction) and the callback also gets an array of status
+ *               codes, one per record.  Needed for flags like
+ *               DB_NOOVERWRITE, which DB_MULTIPLE_KEY doesn't support.
+ *               Default is false.
+ * - 'txn'       Txn to run in (from env.txnBegin()).
+ *
+ * @param {Array} records
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.putMany = function(records, options, callback) {
+  var flags = 0;
+  var perRecord = 0;
+  var txn;
+  var kvs = [];
+  var i;
+
+  if ((typeof options) === 'function') {
+    callback = options;
+    options = undefined;
+  }
+  if (!records || !Array.isArray(records)) {
+    throw new Error('records (Array) required');
+  }
+  if (options) {
+    if (options.flags) {
+      flags = options.flags;
+    }
+    if (options.perRecord) {
+      perRecord = 1;
+    }
+    if (options.txn) {
+      txn = options.txn;
+    }
+  }
+  for (i = 0; i < records.length; i++) {
+    if (!records[i].key) {
+      throw new Error('records[' + i + '].key required');
+    }
+    if (!records[i].val) {
+      throw new Error('records[' + i + '].val required');
+    }
+    kvs.push(records[i].key, records[i].val);
+  }
+  return this._putMany(txn, kvs, flags, perRecord, callback);
 };
 
 
@@ -153,6 +609,8 @@ Db.prototype.putIf = function(options, callback) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
  *
  * @param {Object} options
  * @param {Function} callback
@@ -172,7 +630,7 @@ Db.prototype.putSync = function(options) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._putSync(options.key, options.val, flags);
+  return this._putSync(options.txn, options.key, options.val, flags);
 };
 
 
@@ -185,6 +643,17 @@ Db.prototype.putSync = function(options) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ * - 'snapshot' If the read gets its own transaction, begin it with
+ *             DB_TXN_SNAPSHOT (see openSync()).  Default is what openSync()
+ *             was given.
+ * - 'isolation' 'committed' (DB_READ_COMMITTED) or 'uncommitted'
+ *             (DB_READ_UNCOMMITTED; see openSync()'s 'readUncommitted').
+ *             Without a 'txn', the read then skips the transaction of its
+ *             own: read locks last only as long as the call, and nothing
+ *             is logged.  'uncommitted' can see writes that are later
+ *             aborted.  Overrides 'snapshot'.  Default is neither.
  *
  * @param {Object} options
  * @param {Function} callback
@@ -201,7 +670,155 @@ Db.prototype.get = function(options, callback) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._get(options.key, flags, callback);
+  return this._get(options.txn, options.key, flags,
+                   readTxnFlags(this, options), callback);
+};
+
+
+/**
+ * DB Get wrapper that reads into a Buffer you already have
+ *
+ * The value is written straight into 'buffer' (no allocation, no copy),
+ * and the callback gets (res, length).  If the value doesn't fit,
+ * res.code is DB_BUFFER_SMALL and length is the size it needs.  Pair it
+ * with a BufferPool to keep steady-state reads allocation-free:
+ *
+ *   var buf = pool.acquire();
+ *   db.getInto({key: key, buffer: buf}, function(res, length) {
+ *     ... buf.slice(0, length) ...
+ *     pool.release(buf);
+ *   });
+ *
+ * Required:
+ * - 'key'     Database key to fetch (Buffer)
+ * - 'buffer'  Where to put the value (Buffer)
+ *
+ * Optional:
+ * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ * - 'snapshot' Optional: see get().
+ * - 'isolation' Optional: see get().
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.getInto = function(options, callback) {
+  var flags = 0;
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.key) {
+    throw new Error('options.key required');
+  }
+  if (!options.buffer) {
+    throw new Error('options.buffer required');
+  }
+  if (options.flags) {
+    flags = options.flags;
+  }
+  return this._getInto(options.txn, options.key, options.buffer, flags,
+                       readTxnFlags(this, options), callback);
+};
+
+
+/**
+ * DB Get wrapper for part of a value (DB_DBT_PARTIAL)
+ *
+ * Only the pages holding the requested bytes are read, so this is how to
+ * get at the header of a large value.  The callback gets (res, data),
+ * where data is shorter than 'length' if the value ends first.
+ *
+ * Required:
+ * - 'key'     Database key to fetch (Buffer)
+ * - 'offset'  Byte offset into the value
+ * - 'length'  Number of bytes to read
+ *
+ * Optional:
+ * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ * - 'snapshot' Optional: see get().
+ * - 'isolation' Optional: see get().
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.getRange = function(options, callback) {
+  var flags = 0;
+  var offset = 0;
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.key) {
+    throw new Error('options.key required');
+  }
+  if ((typeof options.length) !== 'number') {
+    throw new Error('options.length (Number) required');
+  }
+  if (options.offset) {
+    offset = options.offset;
+  }
+  if (options.flags) {
+    flags = options.flags;
+  }
+  return this._getRange(options.txn, options.key, offset, options.length,
+                        flags, readTxnFlags(this, options), callback);
+};
+
+/**
+ * DB Bulk Get wrapper
+ *
+ * Looks up every key in one native request, under one transaction.  The
+ * callback gets a single Buffer holding all the values back to back, plus
+ * an offsets Array with an [offset, length] pair per key (in the order the
+ * keys were given).  Missing keys have a length of -1.
+ *
+ * Required:
+ * - 'keys'    Array of Buffers
+ *
+ * Optional:
+ * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ * - 'buffer'  A Buffer to write the values into, so it can be reused
+ *             across calls.  If the values don't fit, a new Buffer is
+ *             handed back instead.
+ * - 'snapshot' Optional: see get().
+ * - 'isolation' Optional: see get().
+ *
+ * @param {Array} keys
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.getMany = function(keys, options, callback) {
+  var flags = 0;
+  var buffer = null;
+  var txn;
+
+  if ((typeof options) === 'function') {
+    callback = options;
+    options = undefined;
+  }
+  if (!keys || !Array.isArray(keys)) {
+    throw new Error('keys (Array) required');
+  }
+  if (options) {
+    if (options.flags) {
+      flags = options.flags;
+    }
+    if (options.buffer) {
+      buffer = options.buffer;
+    }
+    if (options.txn) {
+      txn = options.txn;
+    }
+  }
+  return this._getMany(txn, keys, flags, readTxnFlags(this, options), buffer,
+                       callback);
 };
 
 /**
@@ -213,6 +830,10 @@ Db.prototype.get = function(options, callback) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
+ * - 'snapshot' Optional: see get().
+ * - 'isolation' Optional: see get().
  *
  * @param {Object} options
  * @api public
@@ -228,20 +849,30 @@ Db.prototype.getSync = function(options) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._getSync(options.key, flags);
+  return this._getSync(options.txn, options.key, flags,
+                       readTxnFlags(this, options));
 };
 
 
 
 /**
- * DB CursorGetSync wrapper
+ * DB CursorGet wrapper
  *
  * @param {Object} options
  * Optional:
  * - 'key'
  * - 'limit'
- * - 'initFlag' Optional: Default is DB_SET
- * - 'flags'    Optional: Default is DB_NEXT
+ * - 'initFlag'   Optional: Default is DB_SET
+ * - 'flags'      Optional: Default is DB_NEXT
+ * - 'bulk'       Optional: read whole pages at a time with DB_MULTIPLE_KEY.
+ *                The callback then gets (res, buffer, offsets), where
+ *                offsets holds [keyOffset, keyLength, valOffset, valLength]
+ *                for each record in buffer.  Only forward scans
+ *                (DB_NEXT*) are supported.  Default is false.
+ * - 'bufferSize' Optional: bulk page buffer size.  Default is 64KB.
+ * - 'txn'        Optional: Txn to run in (from env.txnBegin()).
+ * - 'snapshot'   Optional: see get().
+ * - 'isolation'  Optional: see get().
  * @param {Function} callback
  * @api public
  */
@@ -250,6 +881,9 @@ Db.prototype.cursorGet = function(options, callback) {
   var limit = 100;
   var initFlag = BDB.DB_SET;
   var flags = BDB.DB_NEXT;
+  var bulk = false;
+  var bufferSize = 65536;
+  var txn;
 
   if ((typeof options) === 'function') {
     callback = options;
@@ -268,12 +902,27 @@ Db.prototype.cursorGet = function(options, callback) {
     if (options.limit) {
       limit = options.limit;
     }
+    if (options.bulk) {
+      bulk = true;
+    }
+    if (options.bufferSize) {
+      bufferSize = options.bufferSize;
+    }
+    if (options.txn) {
+      txn = options.txn;
+    }
   }
 
   if (!key) {
     key = new Buffer(0);
   }
-  return this._cursorGet(key, limit, initFlag, flags, callback);
+  if (bulk) {
+    return this._cursorGetBulk(txn, key, limit, initFlag, flags,
+                               readTxnFlags(this, options), bufferSize,
+                               callback);
+  }
+  return this._cursorGet(txn, key, limit, initFlag, flags,
+                         readTxnFlags(this, options), callback);
 };
 
 
@@ -285,6 +934,9 @@ Db.prototype.cursorGet = function(options, callback) {
  * - 'limit'
  * - 'initFlag' Optional: Default is DB_SET
  * - 'flags'    Optional: Default is DB_NEXT
+ * - 'txn'      Optional: Txn to run in (from env.txnBegin()).
+ * - 'snapshot' Optional: see get().
+ * - 'isolation' Optional: see get().
  *
  * @param {Object} options
  * @api public
@@ -294,6 +946,7 @@ Db.prototype.cursorGetSync = function(options) {
   var limit = 100;
   var initFlag = BDB.DB_SET;
   var flags = BDB.DB_NEXT;
+  var txn;
 
   if (options) {
     if (options.limit) {
@@ -308,12 +961,90 @@ Db.prototype.cursorGetSync = function(options) {
     if (options.flags) {
       flags = options.flags;
     }
+    if (options.txn) {
+      txn = options.txn;
+    }
   }
 
   if (!key) {
     key = new Buffer(0);
   }
-  return this._cursorGetSync(key, limit, initFlag, flags);
+  return this._cursorGetSync(txn, key, limit, initFlag, flags,
+                             readTxnFlags(this, options));
+};
+
+
+/**
+ * Open a persistent cursor
+ *
+ * The cursor (and its transaction, if any) stays open until closeSync()
+ * is called, so a large range can be read with repeated next()/prev()
+ * calls without seeking again each time.  Only one operation can be in
+ * flight on a cursor at a time.
+ *
+ * In a 'cdb' env the cursor holds the database's read lock until it's
+ * closed, callbacks included.  Async writes to the same database made
+ * before then are held until the last cursor on it closes, and then run
+ * in order; putSync() and delSync() fail with EINVAL instead.
+ *
+ * Optional:
+ * - 'flags'    DB->cursor flags.  Default is 0.
+ * - 'txn'      A Txn to run the cursor in (closing the cursor leaves it
+ *              open), or false for no transaction at all.  By default the
+ *              cursor gets its own transaction if the database is
+ *              transactional.
+ * - 'snapshot' Begin that transaction with DB_TXN_SNAPSHOT.  Default is
+ *              what openSync() was given.
+ * - 'isolation' Read at this isolation instead, without a transaction of
+ *              its own (see get()).
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.cursor = function(options) {
+  var flags = 0;
+  var txn;
+  var useTxn = 1;
+  var txnFlags = readTxnFlags(this, options);
+  if (options) {
+    if (options.flags) {
+      flags = options.flags;
+    }
+    if (options.txn === false) {
+      useTxn = 0;
+    } else if (options.txn) {
+      txn = options.txn;
+    }
+  }
+  if (txnFlags & (BDB.DB_READ_COMMITTED | BDB.DB_READ_UNCOMMITTED)) {
+    flags |= txnFlags;
+    useTxn = 0;
+  }
+  return new Cursor(this, txn, flags, useTxn, txnFlags);
+};
+
+
+/**
+ * Create a readable stream over a key range
+ *
+ * Optional:
+ * - 'gte'        Start at the first key >= gte (Buffer)
+ * - 'lt'         Stop before the first key >= lt (Buffer)
+ * - 'reverse'    Walk the range from the end.  Default is false.
+ * - 'batchSize'  Records read per trip to the thread pool.  Default is 100.
+ * - 'keysOnly'   Emit just the key Buffers
+ * - 'valuesOnly' Emit just the value Buffers
+ * - 'cursor'     Options for the underlying db.cursor()
+ *
+ * Key comparisons assume the default (bytewise) B-tree ordering.  The
+ * stream reads through a cursor(), so in a 'cdb' env writes to the
+ * database are held until 'close' (see cursor()).
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.createReadStream = function(options) {
+  return new ReadStream(this, options);
 };
 
 
@@ -326,6 +1057,8 @@ Db.prototype.cursorGetSync = function(options) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
  *
  * @param {Object} options
  * @param {Function} callback
@@ -342,7 +1075,7 @@ Db.prototype.del = function(options, callback) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._del(options.key, flags, callback);
+  return this._del(options.txn, options.key, flags, callback);
 };
 
 /**
@@ -354,6 +1087,8 @@ Db.prototype.del = function(options, callback) {
  *
  * Optional:
  * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to run in (from env.txnBegin()).  Default is to run in
+ *             a transaction of its own.
  *
  * @param {Object} options
  * @api public
@@ -369,7 +1104,84 @@ Db.prototype.delSync = function(options) {
   if (options.flags) {
     flags = options.flags;
   }
-  return this._delSync(options.key, flags);
+  return this._delSync(options.txn, options.key, flags);
+};
+
+/**
+ * Latency histograms for async operations on this Db
+ *
+ * Returns the usual status object, plus 'get', 'put', 'del' and 'cursor'
+ * (getMany/getInto/getRange count as gets, putMany/putIf/putRange as
+ * puts, and cursor gets/scans as cursor).  Each has:
+ *
+ * - 'queue'     Submitted until a worker thread picked it up
+ * - 'exec'      Running in BDB, deadlock retries included
+ * - 'complete'  Worker done until the callback ran
+ * - 'retries'   Deadlock retries per op (a count, not a time)
+ *
+ * each of which is {count, mean, p50, p99, p999, max}, in microseconds.
+ * Percentiles are accurate to within 12.5%, and never low.
+ *
+ * Optional:
+ * - 'reset'   Start counting from zero again after this.
+ *
+ * @param {Object} options
+ * @api public
+ */
+Db.prototype.latencyStats = function(options) {
+  var reset = 0;
+  if (options && options.reset) {
+    reset = 1;
+  }
+  return this._latencyStats(reset);
+};
+
+/**
+ * Deadlock retry counters for this Db
+ *
+ * Returns the usual status object, plus 'retries' (times a deadlocked
+ * operation was run again) and 'giveUps' (operations that ran out of
+ * retries or time, and failed with DB_LOCK_DEADLOCK).
+ *
+ * @api public
+ */
+Db.prototype.retryStats = function() {
+  return this._retryStats();
+};
+
+/**
+ * Database statistics
+ *
+ * Calls back with (status, stats), where stats is an object of plain
+ * numbers named after the DB_BTREE_STAT/DB_HASH_STAT/DB_QUEUE_STAT fields
+ * without their prefix (bt_nkeys is stats.nkeys).  A full stat walks the
+ * whole database; 'fast' only reads what's kept in the metadata page (for
+ * a btree, nkeys/ndata are then whatever the last full stat saw, unless
+ * the db keeps record numbers), so it's the one to poll.
+ *
+ * Optional:
+ * - 'fast'    DB_FAST_STAT.  Default is false.
+ * - 'flags'   Optional Flags: Default is 0
+ * - 'txn'     Txn to read in (from env.txnBegin()).  Default is none; a
+ *             full stat isn't worth holding read locks across the db for.
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Db.prototype.stats = function(options, callback) {
+  var flags = 0;
+  var txn;
+  if (options) {
+    if (options.flags) {
+      flags = options.flags;
+    }
+    if (options.fast) {
+      flags |= BDB.DB_FAST_STAT;
+    }
+    txn = options.txn;
+  }
+  return this._stat(txn, flags, callback);
 };
 
 exports.Db = Db;
@@ -1,13 +1,21 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 var BDB = require('../build/default/bdb_bindings');
 var DbEnv = BDB.DbEnv;
+var Txn = require('./txn').Txn;
+
+var GB = 1024 * 1024 * 1024;
+
+// BDB takes sizes as gbytes + bytes so they fit in 32 bits
+function splitSize(size) {
+  return { gbytes: Math.floor(size / GB), bytes: size % GB };
+}
 
 /**
  * Open a database environment
  *
  * Required:
  *
- * - 'home'  The Database home, given as a string
+ * - 'home'  The Database home, given as a string (optional with inMemory)
  *
  * Optional:
  *
@@ -20,6 +28,28 @@ var DbEnv = BDB.DbEnv;
  *               - DB_RECOVER
  *               - DB_THREAD
  * - 'mode'    Unix File Permissions to set. Default is 0660.
+ * - 'cdb'     Open a Concurrent Data Store instead (DB_CREATE |
+ *             DB_INIT_CDB | DB_INIT_MPOOL | DB_THREAD): no transactions,
+ *             no log and no recovery, just many readers and one writer at
+ *             a time per database.  Much cheaper writes, for data you can
+ *             afford to lose (a cache, say).  While a db.cursor()
+ *             or createReadStream() is open, async writes to that db are
+ *             held until it's closed, and sync ones fail with EINVAL.
+ *             Ignored if 'flags' is given.
+ * - 'inMemory' Keep everything in memory: the regions are DB_PRIVATE (so
+ *             only this process can use the env), DB_RECOVER is dropped,
+ *             and logs are DB_LOG_IN_MEMORY.  With in-memory databases
+ *             too (see Db.openSync()), nothing touches the disk.  Whatever
+ *             doesn't fit the cache still spills to temporary files.
+ *             Default is false.
+ * - 'logBufferSize' Log buffer size, in bytes.  With in-memory logs, the
+ *             records of every open transaction have to fit in it (or
+ *             writes fail with DB_LOG_BUFFER_FULL).  Default is BDB's.
+ * - 'cacheSize'     Cache size in bytes (see setCacheSize()).  Default is
+ *                   BDB's (256KB), unless DB_CONFIG says otherwise.
+ * - 'cacheRegions'  Number of regions to split the cache into.
+ * - 'cacheMax'      Upper bound for resizeCache(), in bytes.
+ * - 'mmapSize'      Largest read-only file BDB will mmap, in bytes.
  *
  * @param {Object} options
  * @api public
@@ -37,15 +67,56 @@ DbEnv.prototype.openSync = function(options) {
   if (!options) {
     throw new Error('options required');
   }
-  if (!options.home) {
+  if (!options.home && !options.inMemory) {
     throw new Error('options.home required');
   }
   if (options.flags) {
     flags = options.flags;
+  } else if (options.cdb) {
+    flags =
+      BDB.DB_CREATE     |
+      BDB.DB_INIT_CDB   |
+      BDB.DB_INIT_MPOOL |
+      BDB.DB_THREAD;
   }
   if (options.mode) {
     mode = options.mode;
   }
+  var res;
+  if (options.inMemory) {
+    flags = (flags | BDB.DB_PRIVATE) & ~BDB.DB_RECOVER;
+    if (flags & BDB.DB_INIT_LOG) {
+      res = this.setLogConfig(BDB.DB_LOG_IN_MEMORY, true);
+      if (res.code !== 0) {
+        return res;
+      }
+    }
+  }
+  if (options.logBufferSize) {
+    res = this.setLogBufferSize(options.logBufferSize);
+    if (res.code !== 0) {
+      return res;
+    }
+  }
+  if (options.cacheSize) {
+    res = this.setCacheSize({size: options.cacheSize,
+                             regions: options.cacheRegions});
+    if (res.code !== 0) {
+      return res;
+    }
+  }
+  if (options.cacheMax) {
+    res = this.setCacheMax(options.cacheMax);
+    if (res.code !== 0) {
+      return res;
+    }
+  }
+  if (options.mmapSize) {
+    res = this.setMmapSize(options.mmapSize);
+    if (res.code !== 0) {
+      return res;
+    }
+  }
   return this._openSync(options.home, flags, mode);
 };
 
@@ -69,6 +140,290 @@ DbEnv.prototype.closeSync = function(options) {
   return this._closeSync(flags);
 };
 
+/**
+ * Set the size of the shared memory buffer pool (the cache)
+ *
+ * Normally called before openSync().  BDB adds 25% to caches under 500MB
+ * for its own overhead.  Splitting the cache into several regions cuts
+ * contention on the region locks, and is what lets resizeCache() grow or
+ * shrink it later (a region at a time).
+ *
+ * Called after openSync(), it resizes the cache instead, like a
+ * synchronous resizeCache(): 'regions' is ignored, and the cache can't
+ * grow past cacheMax.  Shrinking writes out pages on the calling thread,
+ * so use resizeCache() for that.
+ *
+ * Required:
+ * - 'size'      Total cache size in bytes.
+ *
+ * Optional:
+ * - 'regions'   Number of cache regions.  Default is 1.
+ *
+ * @param {Object} options
+ * @api public
+ */
+DbEnv.prototype.setCacheSize = function(options) {
+  if (!options) {
+    throw new Error('options required');
+  }
+  if (!options.size) {
+    throw new Error('options.size required');
+  }
+  var size = splitSize(options.size);
+  var regions = 1;
+  if (options.regions) {
+    regions = options.regions;
+  }
+  return this._setCacheSize(size.gbytes, size.bytes, regions);
+};
+
+/**
+ * Set the largest the cache can be resized to, in bytes
+ *
+ * Must be called before openSync().  Without it the cache can't grow past
+ * its initial size.
+ *
+ * @param {Number} size
+ * @api public
+ */
+DbEnv.prototype.setCacheMax = function(size) {
+  var max = splitSize(size);
+  return this._setCacheMax(max.gbytes, max.bytes);
+};
+
+/**
+ * Set the largest read-only database file BDB will mmap instead of
+ * reading through the cache, in bytes.  Default is 10MB.
+ *
+ * @param {Number} size
+ * @api public
+ */
+DbEnv.prototype.setMmapSize = function(size) {
+  var mmap = splitSize(size);
+  return this._setMmapSize(mmap.gbytes, mmap.bytes);
+};
+
+/**
+ * Turn log configuration flags on or off
+ *
+ * Takes DB_LOG_IN_MEMORY, DB_LOG_AUTO_REMOVE, ...  DB_LOG_IN_MEMORY has to
+ * be set before openSync() (the 'inMemory' option does it for you).
+ *
+ * @param {Number} flags
+ * @param {Boolean} onoff
+ * @api public
+ */
+DbEnv.prototype.setLogConfig = function(flags, onoff) {
+  return this._setLogConfig(flags, onoff ? 1 : 0);
+};
+
+/**
+ * Get the current cache configuration
+ *
+ * Returns the usual status object, with 'size' (in bytes) and 'regions'
+ * set when code is 0.
+ *
+ * @api public
+ */
+DbEnv.prototype.getCacheSize = function() {
+  var res = this._getCacheSize();
+  if (res.code === 0) {
+    res.size = res.gbytes * GB + res.bytes;
+    res.regions = res.ncache;
+  }
+  return res;
+};
+
+/**
+ * Resize the cache of an open environment
+ *
+ * The cache grows or shrinks a region at a time, up to the size given to
+ * setCacheMax(); shrinking writes out and evicts the pages in the regions
+ * that go away, so this runs on the worker threads.
+ *
+ * @param {Number} size  New cache size in bytes
+ * @param {Function} callback
+ * @api public
+ */
+DbEnv.prototype.resizeCache = function(size, callback) {
+  var cache = splitSize(size);
+  return this._resizeCache(cache.gbytes, cache.bytes, callback);
+};
+
+/**
+ * Give this environment its own worker threads
+ *
+ * By default async operations run on libeio's pool, which they share with
+ * node's file I/O.  With a thread pool, each Db gets its own queue on
+ * these threads instead (the workers take turns between databases), and
+ * completions come back to the event loop in batches.
+ *
+ * Databases created before this is called stay on libeio, so call it
+ * before creating any Db.  closeSync() lets queued work finish, then
+ * stops the threads.
+ *
+ * Optional:
+ * - 'threads'   Number of worker threads.  Default is 4.
+ * - 'priority'  Nice value for the workers (Linux only; raising priority
+ *               needs privileges).  Default is 0.
+ *
+ * @param {Object} options
+ * @api public
+ */
+DbEnv.prototype.setThreadPool = function(options) {
+  var threads = 4;
+  var priority = 0;
+  if (options) {
+    if (options.threads) {
+      threads = options.threads;
+    }
+    if (options.priority) {
+      priority = options.priority;
+    }
+  }
+  return this._setThreadPool(threads, priority);
+};
+
+/**
+ * Start writing dirty pages out of the cache in the background
+ *
+ * A native thread keeps 'percent' of the cache clean with memp_trickle(),
+ * so reads don't stall writing out a dirty page to make room, and
+ * checkpoints have less to flush.  closeSync() stops it; so does
+ * stopTrickle().  trickleStats() returns what it's done so far: 'runs',
+ * 'pagesWritten', 'throttled' (passes cut short by 'rate') and
+ * 'cleanPercent' (as of the last pass).
+ *
+ * Optional:
+ * - 'percent'   Share of the cache to keep clean.  Default is 20.
+ * - 'rate'      Most bytes/second to write, on average (0 is no limit).
+ *               BDB trickles in steps of 1% of the cache, so with a low
+ *               rate the budget builds up over several passes and goes
+ *               out in one step.  Default is 0.
+ * - 'interval'  Milliseconds between passes.  Default is 1000.
+ *
+ * @param {Object} options
+ * @api public
+ */
+DbEnv.prototype.startTrickle = function(options) {
+  var percent = 20;
+  var rate = 0;
+  var interval = 1000;
+  if (options) {
+    if (options.percent) {
+      percent = options.percent;
+    }
+    if (options.rate) {
+      rate = options.rate;
+    }
+    if (options.interval) {
+      interval = options.interval;
+    }
+  }
+  return this._startTrickle(percent, rate, interval);
+};
+
+/**
+ * Start a native maintenance thread
+ *
+ * Every 'interval' it trickles dirty pages (if asked to), checkpoints
+ * once 'kbyte'/'min' is reached, and gets rid of log files that are no
+ * longer needed for recovery -- the things you'd otherwise do with
+ * txnCheckpoint() on a timer and db_archive from cron, without using the
+ * threads requests run on.  closeSync() stops it, as does
+ * stopMaintenance().
+ *
+ * maintenanceStats() has 'checkpoint', 'archive' and 'trickle', each with
+ * 'runs', 'errors', and 'lastUsec', 'maxUsec' and 'totalUsec' for how long
+ * the step took.
+ *
+ * Optional:
+ * - 'interval'    Milliseconds between passes.  Default is 1000.
+ * - 'checkpoint'  Set to false to skip checkpoints.
+ * - 'kbyte'       Checkpoint if MORE than kbyte kilobytes have been logged.
+ * - 'min'         Checkpoint if MORE than min minutes have passed.
+ *                 (With neither, any logged change is checkpointed.)
+ * - 'archive'     true removes unneeded logs; a directory name moves them
+ *                 there instead (same filesystem only).  Default is off.
+ * - 'trickle'     Percent of the cache to keep clean.  Default is off.
+ *
+ * @param {Object} options
+ * @api public
+ */
+DbEnv.prototype.startMaintenance = function(options) {
+  var interval = 1000;
+  var checkpoint = 1;
+  var kbyte = 0;
+  var min = 0;
+  var trickle = 0;
+  var archive = 0;
+  var archiveDir = '';
+  if (options) {
+    if (options.interval) {
+      interval = options.interval;
+    }
+    if (options.checkpoint === false) {
+      checkpoint = 0;
+    }
+    if (options.kbyte) {
+      kbyte = options.kbyte;
+    }
+    if (options.min) {
+      min = options.min;
+    }
+    if (options.trickle) {
+      trickle = options.trickle;
+    }
+    if (options.archive) {
+      archive = 1;
+      if (typeof(options.archive) === 'string') {
+        archiveDir = options.archive;
+      }
+    }
+  }
+  return this._startMaintenance(interval, checkpoint, kbyte, min, trickle,
+                                archive, archiveDir);
+};
+
+/**
+ * Environment statistics
+ *
+ * Calls back with (status, stats), where stats has an object of plain
+ * numbers for each subsystem asked for -- 'mpool', 'lock', 'log', 'txn'
+ * and 'mutex' -- named after the BDB fields without their prefix
+ * (st_cache_hit is stats.mpool.cacheHit).  These are counters read out of
+ * the shared regions, so they're cheap enough to poll.
+ *
+ * Optional:
+ * - 'mpool', 'lock', 'log', 'txn', 'mutex'  Set any of these to only get
+ *             those subsystems.  Default is all of them (which fails for
+ *             subsystems the environment wasn't opened with).
+ * - 'reset'   Zero the counters after reading them (DB_STAT_CLEAR).
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+DbEnv.prototype.stats = function(options, callback) {
+  var names = ['mpool', 'lock', 'log', 'txn', 'mutex'];
+  var which = 0;
+  var flags = 0;
+  if (options) {
+    names.forEach(function(name, i) {
+      if (options[name]) {
+        which |= (1 << i);
+      }
+    });
+    if (options.reset) {
+      flags = BDB.DB_STAT_CLEAR;
+    }
+  }
+  if (!which) {
+    which = (1 << names.length) - 1;
+  }
+  return this._stat(which, flags, callback);
+};
+
 /**
  * TXN Checkpoint wrapper
  *
@@ -98,4 +453,33 @@ DbEnv.prototype.txnCheckpoint = function(options, callback) {
   return this._txnCheckpoint(kbyte, min, flags, callback);
 };
 
+/**
+ * Begin a transaction
+ *
+ * The returned Txn can be passed as the 'txn' option to any Db operation,
+ * and must be finished with commit() or abort().  A Txn is only used by
+ * one operation at a time; operations that share one run one after the
+ * other on the thread pool.
+ *
+ * Optional:
+ * - 'flags'   DB_TXN_SNAPSHOT, DB_TXN_NOSYNC, ... Default is 0.
+ * - 'parent'  Txn to nest this one in.
+ *
+ * @param {Object} options
+ * @api public
+ */
+DbEnv.prototype.txnBegin = function(options) {
+  var flags = 0;
+  var parent = null;
+  if (options) {
+    if (options.flags) {
+      flags = options.flags;
+    }
+    if (options.parent) {
+      parent = options.parent;
+    }
+  }
+  return new Txn(this, parent, flags);
+};
+
 exports.DbEnv = DbEnv;
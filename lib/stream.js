@@ -0,0 +1,210 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var Buffer = require('buffer').Buffer;
+var Stream = require('stream').Stream;
+var util = require('util');
+var BDB = require('../build/default/bdb_bindings');
+var unpack = require('./cursor').unpack;
+
+var EMPTY = new Buffer(0);
+
+// Bytewise comparison, which is what the default B-tree ordering uses
+function compare(a, b) {
+  var len = Math.min(a.length, b.length);
+  var i;
+  for (i = 0; i < len; i++) {
+    if (a[i] !== b[i]) {
+      return a[i] - b[i];
+    }
+  }
+  return a.length - b.length;
+}
+
+
+/**
+ * A readable stream over a key range
+ *
+ * Records are read batchSize at a time through a persistent Cursor.  As
+ * soon as a batch arrives the next one is requested, so the thread pool
+ * is reading ahead while the current batch is being emitted.  pause()
+ * stops the read-ahead, so at most two batches are ever held in memory.
+ * The cursor stays open while paused, so in a 'cdb' env writes to the
+ * database are held until 'close'.
+ *
+ * Emits 'data' ({key, value}, or just the key/value Buffer with
+ * keysOnly/valuesOnly), 'error', 'end' and 'close'.
+ *
+ * @param {Db} db
+ * @param {Object} options see Db.prototype.createReadStream
+ * @api private
+ */
+function ReadStream(db, options) {
+  var self = this;
+  Stream.call(this);
+
+  options = options || {};
+  this.readable = true;
+
+  this._gte = options.gte;
+  this._lt = options.lt;
+  this._reverse = options.reverse ? true : false;
+  this._batchSize = options.batchSize || 100;
+  this._keysOnly = options.keysOnly ? true : false;
+  this._valuesOnly = options.valuesOnly ? true : false;
+
+  this._cursor = db.cursor(options.cursor);
+  this._started = false;
+  this._fetching = false;
+  this._exhausted = false;
+  this._paused = false;
+  this._destroyed = false;
+  this._queue = [];
+  this._pos = 0;
+
+  process.nextTick(function() {
+    self._pump();
+  });
+}
+util.inherits(ReadStream, Stream);
+
+
+ReadStream.prototype._fetch = function() {
+  var self = this;
+  var cursor = this._cursor;
+  var first = !this._started;
+  var count = this._batchSize;
+  var op = this._reverse ? BDB.DB_PREV : BDB.DB_NEXT;
+
+  this._fetching = true;
+  this._started = true;
+
+  function done(res, buffer, offsets) {
+    self._onBatch(res, unpack(buffer, offsets), first);
+  }
+
+  if (first && !this._reverse && this._gte) {
+    return cursor._get(this._gte, count, BDB.DB_SET_RANGE, op, done);
+  }
+  if (first && this._reverse && this._lt) {
+    // Land on the first key >= lt, and walk backwards from there; that
+    // first record is out of range and gets dropped in _onBatch.
+    return cursor._get(this._lt, count + 1, BDB.DB_SET_RANGE, op, done);
+  }
+  return cursor._get(EMPTY, count, 0, op, done);
+};
+
+
+ReadStream.prototype._onBatch = function(res, records, first) {
+  var inRange = [];
+  var i;
+
+  this._fetching = false;
+  if (this._destroyed) {
+    return this._close();
+  }
+  if (res.code !== 0 && res.code !== BDB.DB_NOTFOUND) {
+    var err = new Error(res.message);
+    err.code = res.code;
+    this.emit('error', err);
+    return this.destroy();
+  }
+
+  if (first && this._reverse && this._lt) {
+    if (res.code === BDB.DB_NOTFOUND && records.length === 0) {
+      // Nothing >= lt, so start from the last record instead.
+      this._started = false;
+      this._lt = undefined;
+      return this._pump();
+    }
+    records.shift();
+  }
+  if (res.code === BDB.DB_NOTFOUND) {
+    this._exhausted = true;
+  }
+
+  for (i = 0; i < records.length; i++) {
+    if (!this._reverse && this._lt && compare(records[i].key, this._lt) >= 0) {
+      this._exhausted = true;
+      break;
+    }
+    if (this._reverse && this._gte &&
+        compare(records[i].key, this._gte) < 0) {
+      this._exhausted = true;
+      break;
+    }
+    inRange.push(records[i]);
+  }
+
+  if (this._pos < this._queue.length) {
+    this._queue = this._queue.slice(this._pos).concat(inRange);
+  } else {
+    this._queue = inRange;
+  }
+  this._pos = 0;
+  return this._pump();
+};
+
+
+ReadStream.prototype._pump = function() {
+  var record;
+
+  if (this._destroyed) {
+    return;
+  }
+  // Read ahead while this batch is consumed
+  if (!this._paused && !this._exhausted && !this._fetching) {
+    this._fetch();
+  }
+  while (!this._paused && this._pos < this._queue.length) {
+    record = this._queue[this._pos++];
+    if (this._keysOnly) {
+      this.emit('data', record.key);
+    } else if (this._valuesOnly) {
+      this.emit('data', record.value);
+    } else {
+      this.emit('data', record);
+    }
+    if (this._destroyed) {
+      return;
+    }
+  }
+  if (this._pos >= this._queue.length && this._exhausted && !this._fetching) {
+    this._queue = [];
+    this._pos = 0;
+    this.readable = false;
+    this.emit('end');
+    this.destroy();
+  }
+};
+
+
+ReadStream.prototype._close = function() {
+  if (this._cursor) {
+    this._cursor.closeSync();
+    this._cursor = null;
+    this.emit('close');
+  }
+};
+
+
+ReadStream.prototype.pause = function() {
+  this._paused = true;
+};
+
+
+ReadStream.prototype.resume = function() {
+  this._paused = false;
+  this._pump();
+};
+
+
+ReadStream.prototype.destroy = function() {
+  this.readable = false;
+  this._destroyed = true;
+  this._queue = [];
+  this._pos = 0;
+  if (!this._fetching) {
+    this._close();
+  }
+};
+
+exports.ReadStream = ReadStream;
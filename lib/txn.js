@@ -0,0 +1,45 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var BDB = require('../build/default/bdb_bindings');
+var Txn = BDB.Txn;
+
+/**
+ * Commit a transaction
+ *
+ * Once the callback fires the Txn is resolved, and using it again is an
+ * error (EINVAL).  So is committing while a cursor() opened in it (or in
+ * one of its children) is still open; close those first.  Committing a
+ * parent resolves its children as well.
+ *
+ * Optional:
+ * - 'flags'   DB_TXN_NOSYNC, DB_TXN_SYNC, ... Default is 0.
+ *
+ * @param {Object} options
+ * @param {Function} callback
+ * @api public
+ */
+Txn.prototype.commit = function(options, callback) {
+  var flags = 0;
+  if ((typeof options) === 'function') {
+    callback = options;
+    options = undefined;
+  }
+  if (options && options.flags) {
+    flags = options.flags;
+  }
+  return this._commit(flags, callback);
+};
+
+/**
+ * Abort a transaction
+ *
+ * Like commit(), fails with EINVAL while cursors are open in it, and
+ * aborts its children along with it.
+ *
+ * @param {Function} callback
+ * @api public
+ */
+Txn.prototype.abort = function(callback) {
+  return this._abort(callback);
+};
+
+exports.Txn = Txn;
@@ -4,8 +4,10 @@
 #include <v8.h>
 
 #include "bdb_common.h"
+#include "bdb_cursor.h"
 #include "bdb_db.h"
 #include "bdb_env.h"
+#include "bdb_txn.h"
 
 // Node Macros require these
 using v8::Persistent;
@@ -43,6 +45,7 @@ extern "C" {
     NODE_DEFINE_CONSTANT(target, DB_ENCRYPT);
     NODE_DEFINE_CONSTANT(target, DB_EXCL);
     NODE_DEFINE_CONSTANT(target, DB_FAILCHK);
+    NODE_DEFINE_CONSTANT(target, DB_FAST_STAT);
     NODE_DEFINE_CONSTANT(target, DB_FIRST);
     NODE_DEFINE_CONSTANT(target, DB_FORCE);
     NODE_DEFINE_CONSTANT(target, DB_FORCESYNC);
@@ -60,6 +63,7 @@ extern "C" {
     NODE_DEFINE_CONSTANT(target, DB_INIT_REP);
     NODE_DEFINE_CONSTANT(target, DB_INIT_TXN);
     NODE_DEFINE_CONSTANT(target, DB_JOIN_ITEM);
+    NODE_DEFINE_CONSTANT(target, DB_KEYEXIST);
     NODE_DEFINE_CONSTANT(target, DB_KEYFIRST);
     NODE_DEFINE_CONSTANT(target, DB_KEYLAST);
     NODE_DEFINE_CONSTANT(target, DB_LAST);
@@ -75,6 +79,9 @@ extern "C" {
     NODE_DEFINE_CONSTANT(target, DB_LOCK_RANDOM);
     NODE_DEFINE_CONSTANT(target, DB_LOCK_YOUNGEST);
     NODE_DEFINE_CONSTANT(target, DB_LOCK_NOTGRANTED);
+    NODE_DEFINE_CONSTANT(target, DB_LOG_AUTO_REMOVE);
+    NODE_DEFINE_CONSTANT(target, DB_LOG_BUFFER_FULL);
+    NODE_DEFINE_CONSTANT(target, DB_LOG_IN_MEMORY);
     NODE_DEFINE_CONSTANT(target, DB_MULTIPLE);
     NODE_DEFINE_CONSTANT(target, DB_MULTIPLE_KEY);
     NODE_DEFINE_CONSTANT(target, DB_MULTIVERSION);
@@ -112,6 +119,7 @@ extern "C" {
     NODE_DEFINE_CONSTANT(target, DB_SET);
     NODE_DEFINE_CONSTANT(target, DB_SET_RANGE);
     NODE_DEFINE_CONSTANT(target, DB_SET_RECNO);
+    NODE_DEFINE_CONSTANT(target, DB_STAT_CLEAR);
     NODE_DEFINE_CONSTANT(target, DB_SYSTEM_MEM);
     NODE_DEFINE_CONSTANT(target, DB_THREAD);
     NODE_DEFINE_CONSTANT(target, DB_TIME_NOTGRANTED);
@@ -138,5 +146,7 @@ extern "C" {
 
     DbEnv::Initialize(target);
     Db::Initialize(target);
+    Cursor::Initialize(target);
+    Txn::Initialize(target);
   }
 }
@@ -0,0 +1,235 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bdb_codec.h"
+#include "bdb_object.h"
+
+#define MAGIC_LEN 4
+#define HEADER_LEN 6
+#define RAWLEN_LEN 4
+#define VERSION 1
+
+static const unsigned char MAGIC[MAGIC_LEN] = { 0xf5, 'B', 'D', 'C' };
+
+static void *LoadSymbol(void *handle, const char *prefix, const char *name,
+                        bool required, std::string *error) {
+  std::string sym(prefix);
+  sym += "_";
+  sym += name;
+  void *fn = dlsym(handle, sym.c_str());
+  if (fn == NULL && required && error->empty())
+    *error = "codec is missing " + sym;
+  return fn;
+}
+
+Codec::Codec():
+    _bound(0), _compress(0), _decompress(0), _free(0), _ctx(0),
+    _minSize(0) {}
+
+Codec::~Codec() {
+  if (_free != NULL && _ctx != NULL)
+    _free(_ctx);
+  _ctx = NULL;
+}
+
+Codec *Codec::Load(const char *lib, const char *prefix,
+                   const void *dict, size_t dictlen, size_t minSize,
+                   std::string *error) {
+  // We don't dlclose...same deal as associate
+  void *handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    *error = dlerror();
+    return NULL;
+  }
+
+  Codec *codec = new Codec();
+  codec->_minSize = minSize;
+  codec->_bound = (size_t (*)(void *, size_t))
+      LoadSymbol(handle, prefix, "bound", true, error);
+  codec->_compress =
+      (int (*)(void *, const void *, size_t, void *, size_t, size_t *))
+      LoadSymbol(handle, prefix, "compress", true, error);
+  codec->_decompress = (int (*)(void *, const void *, size_t, void *, size_t))
+      LoadSymbol(handle, prefix, "decompress", true, error);
+  if (codec->_bound == NULL || codec->_compress == NULL ||
+      codec->_decompress == NULL) {
+    delete codec;
+    return NULL;
+  }
+
+  void *(*init)(const void *, size_t) = (void *(*)(const void *, size_t))
+      LoadSymbol(handle, prefix, "init", false, error);
+  codec->_free = (void (*)(void *))
+      LoadSymbol(handle, prefix, "free", false, error);
+  if (init != NULL) {
+    codec->_ctx = init(dict, dictlen);
+    if (codec->_ctx == NULL) {
+      *error = std::string(prefix) + "_init failed";
+      delete codec;
+      return NULL;
+    }
+  } else if (dictlen > 0) {
+    *error = std::string("codec has no ") + prefix + "_init for a dictionary";
+    delete codec;
+    return NULL;
+  }
+
+  return codec;
+}
+
+size_t Codec::Train(const char *lib, const char *prefix,
+                    const void *samples, const size_t *sizes,
+                    unsigned count, void *dict, size_t cap,
+                    std::string *error) {
+  void *handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    *error = dlerror();
+    return 0;
+  }
+
+  size_t (*train)(const void *, const size_t *, unsigned, void *, size_t) =
+      (size_t (*)(const void *, const size_t *, unsigned, void *, size_t))
+      LoadSymbol(handle, prefix, "train", true, error);
+  if (train == NULL)
+    return 0;
+
+  size_t len = train(samples, sizes, count, dict, cap);
+  if (len == 0 || len > cap) {
+    *error = std::string(prefix) + "_train failed";
+    return 0;
+  }
+  return len;
+}
+
+static void WriteHeader(char *buf, unsigned char type) {
+  memcpy(buf, MAGIC, MAGIC_LEN);
+  buf[MAGIC_LEN] = VERSION;
+  buf[MAGIC_LEN + 1] = type;
+}
+
+bool Codec::Tagged(const DBT *in) {
+  const unsigned char *p = static_cast<const unsigned char *>(in->data);
+  return in->size >= HEADER_LEN && memcmp(p, MAGIC, MAGIC_LEN) == 0 &&
+      p[MAGIC_LEN] == VERSION;
+}
+
+int Codec::encode(const DBT *in, DBT *out) {
+  memset(out, 0, sizeof(DBT));
+
+  if (in->size >= _minSize) {
+    size_t cap = _bound(_ctx, in->size);
+    char *buf = static_cast<char *>(malloc(HEADER_LEN + RAWLEN_LEN + cap));
+    if (buf == NULL)
+      return ENOMEM;
+
+    size_t len = 0;
+    int rc = _compress(_ctx, in->data, in->size,
+                       buf + HEADER_LEN + RAWLEN_LEN, cap, &len);
+    // Only worth it if it actually got smaller
+    if (rc == 0 && HEADER_LEN + RAWLEN_LEN + len < in->size) {
+      u_int32_t raw = in->size;
+      WriteHeader(buf, CODEC_COMPRESSED);
+      for (int i = 0; i < RAWLEN_LEN; i++)
+        buf[HEADER_LEN + i] = (raw >> (8 * i)) & 0xff;
+      out->data = buf;
+      out->size = HEADER_LEN + RAWLEN_LEN + len;
+      return 0;
+    }
+    free(buf);
+  }
+
+  // Stored as-is, unless it would read back as one of ours
+  bool escape = in->size >= MAGIC_LEN &&
+      memcmp(in->data, MAGIC, MAGIC_LEN) == 0;
+  size_t header = escape ? HEADER_LEN : 0;
+  char *buf = static_cast<char *>(malloc(header + in->size + 1));
+  if (buf == NULL)
+    return ENOMEM;
+  if (escape)
+    WriteHeader(buf, CODEC_RAW);
+  if (in->size > 0)
+    memcpy(buf + header, in->data, in->size);
+  out->data = buf;
+  out->size = header + in->size;
+  return 0;
+}
+
+int Codec::decode(const DBT *in, DBT *out) {
+  memset(out, 0, sizeof(DBT));
+
+  const unsigned char *p = static_cast<const unsigned char *>(in->data);
+  const unsigned char *body = p;
+  size_t len = in->size;
+  size_t raw = len;
+  unsigned char type = CODEC_RAW;
+
+  if (Tagged(in)) {
+    type = p[MAGIC_LEN + 1];
+    body = p + HEADER_LEN;
+    len = in->size - HEADER_LEN;
+    raw = len;
+    if (type == CODEC_COMPRESSED) {
+      if (len < RAWLEN_LEN)
+        return EINVAL;
+      raw = 0;
+      for (int i = 0; i < RAWLEN_LEN; i++)
+        raw |= static_cast<size_t>(body[i]) << (8 * i);
+      body += RAWLEN_LEN;
+      len -= RAWLEN_LEN;
+    } else if (type != CODEC_RAW) {
+      return EINVAL;
+    }
+  }
+
+  char *buf = static_cast<char *>(malloc(raw > 0 ? raw : 1));
+  if (buf == NULL)
+    return ENOMEM;
+
+  if (type == CODEC_RAW) {
+    if (raw > 0)
+      memcpy(buf, body, raw);
+  } else if (_decompress(_ctx, body, len, buf, raw) != 0) {
+    free(buf);
+    return EINVAL;
+  }
+
+  out->data = buf;
+  out->size = raw;
+  return 0;
+}
+
+int Codec::decodeOwned(DBT *val) {
+  DBT raw;
+  int rc = decode(val, &raw);
+  if (rc != 0)
+    return rc;
+  free(val->data);
+  val->data = raw.data;
+  val->size = raw.size;
+  return 0;
+}
+
+int AppendValue(Codec *codec, BulkOutput *out, const void *data,
+                size_t size) {
+  if (codec == NULL) {
+    if (!out->reserve(size) || !out->append(data, size))
+      return ENOMEM;
+    return 0;
+  }
+
+  DBT in;
+  DBT raw;
+  memset(&in, 0, sizeof(DBT));
+  in.data = const_cast<void *>(data);
+  in.size = size;
+  int rc = codec->decode(&in, &raw);
+  if (rc != 0)
+    return rc;
+  if (!out->reserve(raw.size) || !out->append(raw.data, raw.size))
+    rc = ENOMEM;
+  free(raw.data);
+  return rc;
+}
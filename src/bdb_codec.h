@@ -0,0 +1,91 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_CODEC_H_
+#define BDB_CODEC_H_
+
+#include <db.h>
+#include <stddef.h>
+
+#include <string>
+
+class BulkOutput;
+
+// A value compressor loaded from a shared library, in the same spirit as
+// associate()'s callback.  The library exports, for some prefix:
+//
+//   size_t <prefix>_bound(void *ctx, size_t len);
+//   int    <prefix>_compress(void *ctx, const void *src, size_t len,
+//                            void *dst, size_t cap, size_t *outlen);
+//   int    <prefix>_decompress(void *ctx, const void *src, size_t len,
+//                              void *dst, size_t rawlen);
+//
+// and optionally:
+//
+//   void  *<prefix>_init(const void *dict, size_t dictlen);
+//   void   <prefix>_free(void *ctx);
+//   size_t <prefix>_train(const void *samples, const size_t *sizes,
+//                         unsigned count, void *dict, size_t cap);
+//
+// compress/decompress return 0 on success, and are called from several
+// worker threads at once with the same ctx.  (An LZ4 or zstd shim is a few
+// lines; zstd's ZDICT_trainFromBuffer() is what _train is for.)
+//
+// A compressed value is tagged with a 6-byte header: a 4-byte magic
+// (0xf5 "BDC"; 0xf5 never appears in UTF-8, so text and JSON never start
+// with it), a version byte and a type byte:
+//
+//   magic 1 CODEC_COMPRESSED  4-byte little-endian raw length, compressed
+//   magic 1 CODEC_RAW         value
+//
+// Values that aren't worth compressing are stored untagged, just as they
+// would be without a codec, and anything untagged reads back unchanged.
+// So a codec can be turned on for a database that already has data in
+// it.  CODEC_RAW is only needed for a value that happens to start with
+// the magic itself.
+class Codec {
+ public:
+  static const unsigned char CODEC_RAW = 0;
+  static const unsigned char CODEC_COMPRESSED = 1;
+
+  ~Codec();
+
+  // NULL (and *error set) if the library or a required symbol is missing
+  static Codec *Load(const char *lib, const char *prefix,
+                     const void *dict, size_t dictlen, size_t minSize,
+                     std::string *error);
+
+  // Trains a dictionary from samples; returns its size (0 on failure)
+  static size_t Train(const char *lib, const char *prefix,
+                      const void *samples, const size_t *sizes,
+                      unsigned count, void *dict, size_t cap,
+                      std::string *error);
+
+  // Both fill in a malloc'd out->data (the caller frees it) and return 0,
+  // or return an errno/BDB error.
+  int encode(const DBT *in, DBT *out);
+  int decode(const DBT *in, DBT *out);
+
+  // decode() in place, for a DBT whose data we own (DB_DBT_MALLOC)
+  int decodeOwned(DBT *val);
+
+  // Whether a stored value carries our header
+  static bool Tagged(const DBT *in);
+
+ private:
+  Codec();
+  Codec(const Codec &);
+  Codec &operator=(const Codec &);
+
+  size_t (*_bound)(void *, size_t);
+  int (*_compress)(void *, const void *, size_t, void *, size_t, size_t *);
+  int (*_decompress)(void *, const void *, size_t, void *, size_t);
+  void (*_free)(void *);
+  void *_ctx;
+  size_t _minSize;
+};
+
+// Appends a stored value to out, decoding it first if there's a codec.
+// Returns 0 or an errno.
+int AppendValue(Codec *codec, BulkOutput *out, const void *data,
+                size_t size);
+
+#endif  // BDB_CODEC_H_
@@ -19,6 +19,13 @@ extern v8::Persistent<v8::String> val_sym;
   VAR->Set(status_code_sym, v8::Integer::New(CODE));            \
   VAR->Set(err_message_sym, v8::String::New(MSG));
 
+// The status handed to async callbacks.  Success (by far the common case)
+// shares one frozen object; only failures build a new object and pay for
+// the error string.  Unlike before, a success status can't be extended:
+// properties a caller adds to it are dropped (or throw in strict mode)
+// rather than showing up in every later callback.
+v8::Local<v8::Object> StatusObject(int code);
+
 #define RET_EXC(MSG)                                                    \
   return v8::ThrowException(v8::Exception::Error(v8::String::New(MSG)))
 
@@ -45,12 +52,29 @@ extern v8::Persistent<v8::String> val_sym;
     RET_EXC("argument " #I " must be a string");        \
   v8::String::Utf8Value VAR(args[I]->ToString());
 
+// A string, or null/undefined for "none" (VAR is then NULL)
+#define OPT_STR_ARG(I, VAR)                                     \
+  REQ_ARGS();                                                   \
+  if (args.Length() > (I) && !args[I]->IsString() &&            \
+      !args[I]->IsNull() && !args[I]->IsUndefined())            \
+    RET_EXC("argument " #I " must be a string");                \
+  v8::String::Utf8Value _ ## VAR(args[I]->ToString());          \
+  const char *VAR = NULL;                                       \
+  if (args.Length() > (I) && args[I]->IsString())               \
+    VAR = *_ ## VAR;
+
 #define REQ_OBJ_ARG(I, VAR)                             \
   REQ_ARGS();                                           \
   if (args.Length() <= (I) || !args[I]->IsObject())     \
     RET_EXC("argument " #I " must be a object");        \
   v8::Local<v8::Object> VAR(args[I]->ToObject());
 
+#define REQ_ARR_ARG(I, VAR)                                     \
+  REQ_ARGS();                                                   \
+  if (args.Length() <= (I) || !args[I]->IsArray())              \
+    RET_EXC("argument " #I " must be an array");                \
+  v8::Local<v8::Array> VAR = v8::Local<v8::Array>::Cast(args[I]);
+
 #define REQ_BUF_ARG(I, VAR)                                 \
   REQ_ARGS();                                               \
   v8::Local<v8::Value> __ ## VAR = args[I];                 \
@@ -60,33 +84,74 @@ extern v8::Persistent<v8::String> val_sym;
   char *VAR = node::Buffer::Data(_ ## VAR);                 \
   size_t VAR ## _len = node::Buffer::Length(_ ## VAR);
 
-#define TXN_BEGIN(DBOBJ)                         \
-  DB_ENV *&_env = DBOBJ->_env;                   \
-  DB_TXN *_txn = NULL;                           \
-  int _attempts = 0;                             \
-  int _rc = 0;                                   \
-again:                                           \
-  if (DBOBJ->_transactional) {                   \
-    _rc = _env->txn_begin(_env, NULL, &_txn, 0); \
-    if (_rc != 0)                                \
-      goto out;                                  \
-  }                                              \
+// Reads at these isolation levels don't get a transaction of their own;
+// the flag goes on the get or cursor instead, so locks are only held for
+// the call (or the cursor position), and nothing is logged.
+#define READ_ISOLATION (DB_READ_COMMITTED | DB_READ_UNCOMMITTED)
+
+// UTXN is the caller's Txn (or NULL).  With one, the operation runs inside
+// it and leaves commit/abort (including after a deadlock) to the caller;
+// without one, each operation gets its own auto-commit transaction (begun
+// with TXNFLAGS, e.g. DB_TXN_SNAPSHOT, unless they include READ_ISOLATION),
+// which DBOBJ->_retry decides whether to run again after a deadlock.
+//
+// TXN_BEGIN_RETRY is for async ops, which keep their RetryState in the
+// baton so a retry can be deferred.  After TXN_END, a deferred retry shows
+// up as _retryState->pending, with STATUS still DB_LOCK_DEADLOCK.
+//
+// Everything after TXN_BEGIN_* runs again on a retry: inline through the
+// goto, or deferred by calling the whole EIO function again on the same
+// baton.  So whatever an attempt accumulates (status, records, output,
+// malloc'd values) has to be reset right after it.
+#define TXN_BEGIN(DBOBJ, UTXN)                        \
+  TXN_BEGIN_FLAGS(DBOBJ, UTXN, 0)
+
+#define TXN_BEGIN_FLAGS(DBOBJ, UTXN, TXNFLAGS)        \
+  RetryState _inlineRetry;                            \
+  TXN_BEGIN_RETRY(DBOBJ, UTXN, &_inlineRetry, TXNFLAGS)
+
+#define TXN_BEGIN_RETRY(DBOBJ, UTXN, STATE, TXNFLAGS) \
+  DB_ENV *&_env = DBOBJ->_env;                        \
+  Txn *_utxn = (UTXN);                                \
+  DB_TXN *_txn = NULL;                                \
+  RetryState *_retryState = (STATE);                  \
+  int _rc = 0;                                        \
+  if (_utxn != NULL)                                  \
+    _utxn->lock();                                    \
+again:                                                \
+  if (_utxn != NULL) {                                \
+    _txn = _utxn->getDB_TXN();                        \
+    if (_txn == NULL) {                               \
+      _rc = EINVAL;                                   \
+      goto out;                                       \
+    }                                                 \
+  } else if (DBOBJ->_transactional &&                 \
+             ((TXNFLAGS) & READ_ISOLATION) == 0) {    \
+    _rc = _env->txn_begin(_env, NULL, &_txn,          \
+                          (TXNFLAGS));                \
+    if (_rc != 0)                                     \
+      goto out;                                       \
+  }                                                   \
 
 
 #define TXN_END(DBOBJ, STATUS)                                          \
-  if (DBOBJ->_transactional) {                                          \
+  if (_utxn == NULL && _txn != NULL) {                                  \
     if (STATUS == 0) {                                                  \
       STATUS = _txn->commit(_txn, 0);                                   \
-    } else if (STATUS == DB_LOCK_DEADLOCK &&                            \
-               ++_attempts <= DBOBJ->_retries) {                        \
-      _txn->abort(_txn);                                                \
-      sched_yield();                                                    \
-      goto again;                                                       \
     } else {                                                            \
       _txn->abort(_txn);                                                \
     }                                                                   \
+    _txn = NULL;                                                        \
   }                                                                     \
- out:
+  if (_utxn == NULL && DBOBJ->_transactional &&                         \
+      STATUS == DB_LOCK_DEADLOCK &&                                     \
+      DBOBJ->_retry.retry(_retryState) && !_retryState->pending)        \
+    goto again;                                                         \
+ out:                                                                   \
+  if (_rc != 0)                                                         \
+    STATUS = _rc;                                                       \
+  if (_utxn != NULL)                                                    \
+    _utxn->unlock();
 
 #define INIT_DBT(NAME, LEN)                              \
   DBT dbt_ ## NAME = {0};                                \
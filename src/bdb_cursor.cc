@@ -0,0 +1,300 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bdb_codec.h"
+#include "bdb_common.h"
+#include "bdb_cursor.h"
+#include "bdb_db.h"
+#include "bdb_pool.h"
+#include "bdb_txn.h"
+
+using v8::FunctionTemplate;
+
+class EIOCursorBaton: public EIOBaton {
+ public:
+  explicit EIOCursorBaton(Cursor *cursor):
+      EIOBaton(cursor), count(0), initFlag(0), out() {
+    memset(&key, 0, sizeof(DBT));
+  }
+
+  virtual ~EIOCursorBaton() {
+    keyHandle.Dispose();
+  }
+
+  int count;
+  int initFlag;
+  DBT key;
+  v8::Persistent<v8::Object> keyHandle;
+  BulkOutput out;
+
+ private:
+  EIOCursorBaton(const EIOCursorBaton &);
+  EIOCursorBaton &operator=(const EIOCursorBaton &);
+};
+
+
+Cursor::Cursor():
+    DbObject(), _db(0), _dbc(0), _txn(0), _userTxn(0), _busy(false) {
+  memset(&_key, 0, sizeof(DBT));
+  memset(&_val, 0, sizeof(DBT));
+  _key.flags = DB_DBT_REALLOC;
+  _val.flags = DB_DBT_REALLOC;
+}
+
+Cursor::~Cursor() {
+  close();
+}
+
+int Cursor::close() {
+  int rc = 0;
+
+  // If the database was closed first, BDB already closed our DBC for us.
+  if (_db != NULL && _db->_db == NULL)
+    _dbc = NULL;
+
+  if (_userTxn != NULL)
+    _userTxn->lock();
+  if (_dbc != NULL) {
+    rc = _dbc->close(_dbc);
+    _dbc = NULL;
+  }
+  if (_userTxn != NULL) {
+    // Lets the Txn be resolved again
+    _userTxn->removeCursor();
+    _userTxn->unlock();
+  }
+  _userTxn = NULL;
+  _userTxnHandle.Dispose();
+  _userTxnHandle.Clear();
+  if (_txn != NULL) {
+    if (rc == 0) {
+      rc = _txn->commit(_txn, 0);
+    } else {
+      _txn->abort(_txn);
+    }
+    _txn = NULL;
+  }
+  if (_key.data != NULL) {
+    free(_key.data);
+    _key.data = NULL;
+  }
+  if (_val.data != NULL) {
+    free(_val.data);
+    _val.data = NULL;
+  }
+  // CDB writes held for us can go now
+  if (_db != NULL)
+    _db->cursorClosed();
+  _dbHandle.Dispose();
+  _dbHandle.Clear();
+  _db = NULL;
+
+  return rc;
+}
+
+// Start EIO Methods
+
+int Cursor::EIO_Get(eio_req *req) {
+  EIOCursorBaton *baton = static_cast<EIOCursorBaton *>(req->data);
+  Cursor *cursor = dynamic_cast<Cursor *>(baton->object);
+  if (cursor == NULL || cursor->_dbc == NULL || cursor->_db->_db == NULL) {
+    baton->status = EINVAL;
+    return 0;
+  }
+
+  DBC *&dbc = cursor->_dbc;
+  DBT &key = cursor->_key;
+  DBT &val = cursor->_val;
+  int op = baton->flags;
+  int rc = 0;
+  int i = 0;
+
+  if (baton->initFlag != 0) {
+    op = baton->initFlag;
+    void *p = realloc(key.data, baton->key.size > 0 ? baton->key.size : 1);
+    if (p == NULL) {
+      baton->status = ENOMEM;
+      return 0;
+    }
+    key.data = p;
+    key.size = baton->key.size;
+    memcpy(key.data, baton->key.data, key.size);
+  }
+
+  if (cursor->_userTxn != NULL)
+    cursor->_userTxn->lock();
+
+  while (i < baton->count) {
+    rc = dbc->get(dbc, &key, &val, op);
+    if (rc != 0)
+      break;
+    if (!baton->out.reserve(key.size) ||
+        !baton->out.append(key.data, key.size)) {
+      rc = ENOMEM;
+      break;
+    }
+    rc = AppendValue(cursor->_db->_codec, &(baton->out), val.data, val.size);
+    if (rc != 0)
+      break;
+    op = baton->flags;
+    i++;
+  }
+
+  if (cursor->_userTxn != NULL)
+    cursor->_userTxn->unlock();
+
+  baton->status = rc;
+  return 0;
+}
+
+int Cursor::EIO_AfterGet(eio_req *req) {
+  v8::HandleScope scope;
+  EIOCursorBaton *baton = static_cast<EIOCursorBaton *>(req->data);
+
+  dynamic_cast<Cursor *>(baton->object)->_busy = false;
+
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
+
+  // [key offset, key length, value offset, value length] per record
+  v8::Handle<v8::Value> argv[3] = {};
+  argv[0] = msg;
+  argv[1] = baton->out.buffer();
+  argv[2] = baton->out.offsetArray();
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 3, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
+// Start V8 Exposed Methods
+
+v8::Handle<v8::Value> Cursor::New(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  REQ_OBJ_ARG(0, dbObj);
+  OPT_TXN_ARG(1, txn);
+  REQ_INT_ARG(2, flags);
+  REQ_INT_ARG(3, useTxn);
+  REQ_INT_ARG(4, txnFlags);
+
+  Db *db = node::ObjectWrap::Unwrap<Db>(dbObj);
+  if (db == NULL || db->_db == NULL)
+    RET_EXC("database is not open");
+
+  Cursor *cursor = new Cursor();
+  cursor->Wrap(args.This());
+
+  int rc = 0;
+  DB_TXN *dbtxn = NULL;
+  if (txn != NULL) {
+    // Held until the Txn knows about us, so a queued commit can't slip in
+    txn->lock();
+    dbtxn = txn->getDB_TXN();
+    if (dbtxn == NULL) {
+      txn->unlock();
+      RET_EXC("transaction is already resolved");
+    }
+  } else if (useTxn && db->_transactional) {
+    rc = db->_env->txn_begin(db->_env, NULL, &(cursor->_txn), txnFlags);
+    if (rc != 0)
+      RET_EXC(db_strerror(rc));
+  }
+
+  rc = db->_db->cursor(db->_db,
+                       dbtxn != NULL ? dbtxn : cursor->_txn,
+                       &(cursor->_dbc),
+                       flags);
+  if (rc == 0 && txn != NULL) {
+    txn->addCursor();
+    cursor->_userTxn = txn;
+    cursor->_userTxnHandle = v8::Persistent<v8::Object>::New(txn->handle_);
+  }
+  if (txn != NULL)
+    txn->unlock();
+  if (rc != 0) {
+    if (cursor->_txn != NULL) {
+      cursor->_txn->abort(cursor->_txn);
+      cursor->_txn = NULL;
+    }
+    cursor->_dbc = NULL;
+    RET_EXC(db_strerror(rc));
+  }
+
+  // Keep the Db around for as long as we are open
+  cursor->_db = db;
+  db->cursorOpened();
+  cursor->_dbHandle = v8::Persistent<v8::Object>::New(dbObj);
+  cursor->_queue = db->_queue;
+  cursor->_latency = db->_latency;
+
+  return args.This();
+}
+
+v8::Handle<v8::Value> Cursor::CloseS(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  Cursor *cursor = node::ObjectWrap::Unwrap<Cursor>(args.This());
+  if (cursor->_busy)
+    RET_EXC("cursor operation in progress");
+
+  int rc = cursor->close();
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> Cursor::Get(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  Cursor *cursor = node::ObjectWrap::Unwrap<Cursor>(args.This());
+
+  REQ_BUF_ARG(0, key);
+  REQ_INT_ARG(1, count);
+  REQ_INT_ARG(2, initFlag);
+  REQ_INT_ARG(3, flags);
+  REQ_FN_ARG(4, cb);
+
+  if (cursor->_dbc == NULL)
+    RET_EXC("cursor is closed");
+  // A DBC (and its txn) can only be used by one thread at a time
+  if (cursor->_busy)
+    RET_EXC("cursor operation in progress");
+
+  EIOCursorBaton *baton = new EIOCursorBaton(cursor);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->keyHandle = v8::Persistent<v8::Object>::New(_key);
+  baton->key.data = key;
+  baton->key.size = key_len;
+  baton->count = count;
+  baton->initFlag = initFlag;
+  baton->flags = flags;
+
+  cursor->_busy = true;
+  cursor->Ref();
+  baton->timing.submit(OP_CURSOR);
+  WorkerPool::Submit(cursor->_queue, EIO_Get, EIO_AfterGet, baton);
+
+  return v8::Undefined();
+}
+
+void Cursor::Initialize(v8::Handle<v8::Object> target) {
+  v8::HandleScope scope;
+
+  v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(New);
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  NODE_SET_PROTOTYPE_METHOD(t, "_closeSync", CloseS);
+  NODE_SET_PROTOTYPE_METHOD(t, "_get", Get);
+
+  target->Set(v8::String::NewSymbol("Cursor"), t->GetFunction());
+}
@@ -0,0 +1,47 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_CURSOR_H_
+#define BDB_CURSOR_H_
+
+#include <db.h>
+
+#include "bdb_object.h"
+
+// A DBC (and optionally the transaction it runs in) that stays open across
+// calls, so a scan can be consumed in increments without re-seeking.  The
+// cursor either owns its transaction, or runs in a caller's Txn, which it
+// then leaves open on close.
+class Cursor: public DbObject {
+ public:
+  Cursor();
+  virtual ~Cursor();
+
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  static v8::Handle<v8::Value> CloseS(const v8::Arguments &);
+  static v8::Handle<v8::Value> Get(const v8::Arguments &);
+  static v8::Handle<v8::Value> New(const v8::Arguments &);
+
+ protected:
+  static int EIO_Get(eio_req *req);
+  static int EIO_AfterGet(eio_req *req);
+
+ private:
+  Cursor(const Cursor &);
+  Cursor &operator=(const Cursor &);
+
+  int close();
+
+  Db *_db;
+  v8::Persistent<v8::Object> _dbHandle;
+  DBC *_dbc;
+  DB_TXN *_txn;
+  Txn *_userTxn;
+  v8::Persistent<v8::Object> _userTxnHandle;
+  bool _busy;
+
+  // Scratch space reused (DB_DBT_REALLOC) by every get on this cursor
+  DBT _key;
+  DBT _val;
+};
+
+#endif  // BDB_CURSOR_H_
@@ -1,17 +1,25 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 #include <dlfcn.h>
+#include <errno.h>
 #include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
 #include <node_buffer.h>
 
+#include "bdb_codec.h"
 #include "bdb_common.h"
 #include "bdb_db.h"
 #include "bdb_env.h"
+#include "bdb_gate.h"
+#include "bdb_hash.h"
+#include "bdb_pool.h"
+#include "bdb_stats.h"
+#include "bdb_txn.h"
 
 
 using v8::FunctionTemplate;
@@ -19,20 +27,47 @@ using v8::Persistent;
 using v8::String;
 
 v8::Persistent<v8::String> fd_sym;
+v8::Persistent<v8::String> count_sym;
+v8::Persistent<v8::String> mean_sym;
+v8::Persistent<v8::String> p50_sym;
+v8::Persistent<v8::String> p99_sym;
+v8::Persistent<v8::String> p999_sym;
+v8::Persistent<v8::String> max_sym;
+v8::Persistent<v8::String> retries_sym;
+v8::Persistent<v8::String> give_ups_sym;
 
 class EIODbBaton: public EIOBaton {
  public:
-  explicit EIODbBaton(Db *db): EIOBaton(db), env(0), records() {
+  explicit EIODbBaton(Db *db): EIOBaton(db), env(0), records(), stripe(-1) {
     memset(&key, 0, sizeof(DBT));
     memset(&val, 0, sizeof(DBT));
   }
 
-  virtual ~EIODbBaton() { records.clear(); }
+  virtual ~EIODbBaton() {
+    records.clear();
+    keyHandle.Dispose();
+    target.Dispose();
+  }
+
+  // Drops what a cursor read has collected, for a retry to start over
+  void clearRecords() {
+    for (size_t i = 0; i < records.size(); i++) {
+      free(records[i].first->data);
+      free(records[i].first);
+      free(records[i].second->data);
+      free(records[i].second);
+    }
+    records.clear();
+  }
 
   DbEnv *env;
   DBT key;
   DBT val;
 
+  // GetInto: the caller's Buffers, kept alive while we read into them
+  v8::Persistent<v8::Object> keyHandle;
+  v8::Persistent<v8::Object> target;
+
   // Cursors only
   int limit;
   int initFlag;
@@ -40,12 +75,104 @@ class EIODbBaton: public EIOBaton {
 
   // PutIf
   DBT oldVal;
+
+  // The KeyGate stripe this write holds, if it went through one
+  int stripe;
  private:
   EIODbBaton(const EIODbBaton &);
   EIODbBaton &operator=(const EIODbBaton &);
 };
 
 
+class EIOStatBaton: public EIOBaton {
+ public:
+  explicit EIOStatBaton(Db *db): EIOBaton(db), type(DB_UNKNOWN), sp(0) {}
+
+  virtual ~EIOStatBaton() {
+    if (sp != NULL)
+      free(sp);
+  }
+
+  DBTYPE type;
+  void *sp;
+
+ private:
+  EIOStatBaton(const EIOStatBaton &);
+  EIOStatBaton &operator=(const EIOStatBaton &);
+};
+
+
+class EIOBulkBaton: public EIOBaton {
+ public:
+  explicit EIOBulkBaton(Db *db):
+      EIOBaton(db), perRecord(false), keys(), vals(), codes(),
+      limit(0), initFlag(0), bufferSize(0), out() {}
+
+  virtual ~EIOBulkBaton() {
+    records.Dispose();
+  }
+
+  // Holds the caller's array so the Buffers we point into stay alive
+  v8::Persistent<v8::Object> records;
+  bool perRecord;
+  std::vector<DBT> keys;
+  std::vector<DBT> vals;
+  std::vector<int> codes;
+
+  // Cursor scans only
+  int limit;
+  int initFlag;
+  size_t bufferSize;
+
+  // Bulk reads
+  BulkOutput out;
+
+ private:
+  EIOBulkBaton(const EIOBulkBaton &);
+  EIOBulkBaton &operator=(const EIOBulkBaton &);
+};
+
+
+// A batch of auto-commit puts that share one transaction (group commit).
+class EIOGroupBaton: public EIOBaton {
+ public:
+  explicit EIOGroupBaton(Db *db): EIOBaton(db), ops() {}
+  virtual ~EIOGroupBaton() {}
+
+  std::vector<EIODbBaton *> ops;
+
+ private:
+  EIOGroupBaton(const EIOGroupBaton &);
+  EIOGroupBaton &operator=(const EIOGroupBaton &);
+};
+
+
+// B-tree default ordering (__bam_defcmp), so a sorted batch walks the tree
+// left to right.
+class KeyOrder {
+ public:
+  explicit KeyOrder(const std::vector<DBT> &keys): _keys(keys) {}
+
+  bool operator()(size_t a, size_t b) const {
+    const DBT &ka = _keys[a];
+    const DBT &kb = _keys[b];
+    size_t len = ka.size < kb.size ? ka.size : kb.size;
+    int rc = memcmp(ka.data, kb.data, len);
+    if (rc != 0)
+      return rc < 0;
+    return ka.size < kb.size;
+  }
+
+ private:
+  const std::vector<DBT> &_keys;
+};
+
+
+static void FreeValue(char *data, void *hint) {
+  free(data);
+}
+
+
 #define ADD_CURSOR_RECORD(KEY, VAL, OBJ, ARR, POS)                      \
   OBJ = v8::Object::New();                                              \
   OBJ->Set(key_sym, node::Buffer::New(static_cast<char *>(KEY->data),   \
@@ -54,13 +181,38 @@ class EIODbBaton: public EIOBaton {
                                       VAL->size)->handle_);             \
   ARR->Set(v8::Number::New(POS), OBJ)
 
-Db::Db(): DbObject(), _db(0), _env(0), _retries(0), _transactional(false) {}
+Db::Db(): DbObject(), _db(0), _env(0), _retry(), _transactional(false),
+          _concurrent(false), _groupMax(0), _groupWindow(0), _group(0),
+          _groupsRunning(0), _codec(0), _associated(false), _gate(0),
+          _cursors(0), _held() {
+  ev_timer_init(&_groupTimer, GroupTimeout, 0., 0.);
+  _groupTimer.data = this;
+  pthread_mutex_init(&_groupLock, NULL);
+  pthread_cond_init(&_groupIdle, NULL);
+  _latency = new LatencyStats();
+}
 
 Db::~Db() {
   if (_db != NULL) {
     _db->close(_db, 0);
     _db = NULL;
   }
+  if (_codec != NULL) {
+    delete _codec;
+    _codec = NULL;
+  }
+  delete _gate;
+  _gate = NULL;
+  delete _latency;
+  _latency = NULL;
+  // Before _envHandle lets go: the env owns the pool
+  if (_queue != NULL) {
+    _queue->pool->destroyQueue(_queue);
+    _queue = NULL;
+  }
+  _envHandle.Dispose();
+  pthread_cond_destroy(&_groupIdle);
+  pthread_mutex_destroy(&_groupLock);
 }
 
 // Start EIO Methods
@@ -73,13 +225,25 @@ int Db::EIO_Get(eio_req *req) {
   Db *dbObj = dynamic_cast<Db *>(baton->object);
   DB *&db = dbObj->_db;
 
-  baton->val.flags = DB_DBT_MALLOC;
+  // GetRange has already set DB_DBT_PARTIAL (and doff/dlen)
+  baton->val.flags |= DB_DBT_MALLOC;
 
-  TXN_BEGIN(dbObj);
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
 
-  baton->status = db->get(db, _txn, &(baton->key), &(baton->val), baton->flags);
+  // From an attempt whose commit lost a deadlock
+  if (baton->val.data != NULL) {
+    free(baton->val.data);
+    baton->val.data = NULL;
+  }
+
+  baton->status = db->get(db, _txn, &(baton->key), &(baton->val),
+                          baton->flags | (baton->txnFlags & READ_ISOLATION));
 
   TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  if (baton->status == 0 && dbObj->_codec != NULL)
+    baton->status = dbObj->_codec->decodeOwned(&(baton->val));
 
   return 0;
 }
@@ -87,11 +251,18 @@ int Db::EIO_Get(eio_req *req) {
 int Db::EIO_AfterGet(eio_req *req) {
   v8::HandleScope scope;
   EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
-  ev_unref(EV_DEFAULT_UC);
 
-  DB_RES(baton->status, db_strerror(baton->status), msg);
-  node::Buffer *buf = node::Buffer::New(static_cast<char *>(baton->val.data),
-                                        baton->val.size);
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
+
+  // BDB malloc'd the value for us, so the Buffer can just take it over
+  node::Buffer *buf = NULL;
+  if (baton->val.data != NULL) {
+    buf = node::Buffer::New(static_cast<char *>(baton->val.data),
+                            baton->val.size, FreeValue, NULL);
+    baton->val.data = NULL;
+  } else {
+    buf = node::Buffer::New(0);
+  }
 
   v8::Handle<v8::Value> argv[2] = {};
   argv[0] = msg;
@@ -110,6 +281,201 @@ int Db::EIO_AfterGet(eio_req *req) {
   return 0;
 }
 
+int Db::EIO_GetInto(eio_req *req) {
+  EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
+  if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
+    return 0;
+
+  Db *dbObj = dynamic_cast<Db *>(baton->object);
+  DB *&db = dbObj->_db;
+
+  Codec *codec = dbObj->_codec;
+  DBT stored = {0};
+  DBT raw = {0};
+  memset(&stored, 0, sizeof(DBT));
+
+  // val.data/ulen already point at the caller's Buffer.  With a codec we
+  // have to go through a copy of the stored (encoded) value first.
+  baton->val.flags = DB_DBT_USERMEM;
+  stored.flags = DB_DBT_MALLOC;
+
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  if (stored.data != NULL) {
+    free(stored.data);
+    stored.data = NULL;
+  }
+
+  baton->status = db->get(db, _txn, &(baton->key),
+                          codec != NULL ? &stored : &(baton->val),
+                          baton->flags | (baton->txnFlags & READ_ISOLATION));
+
+  TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  if (codec != NULL && baton->status == 0) {
+    baton->status = codec->decode(&stored, &raw);
+    if (baton->status == 0) {
+      baton->val.size = raw.size;
+      if (raw.size > baton->val.ulen) {
+        baton->status = DB_BUFFER_SMALL;
+      } else if (raw.size > 0) {
+        memcpy(baton->val.data, raw.data, raw.size);
+      }
+      free(raw.data);
+    }
+  }
+  if (stored.data != NULL)
+    free(stored.data);
+
+  return 0;
+}
+
+int Db::EIO_AfterGetInto(eio_req *req) {
+  v8::HandleScope scope;
+  EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
+
+  // On DB_BUFFER_SMALL, val.size is what the value needs
+  v8::Handle<v8::Value> argv[2] = {};
+  argv[0] = StatusObject(baton->status);
+  if (baton->status == 0 || baton->status == DB_BUFFER_SMALL) {
+    argv[1] = v8::Integer::NewFromUnsigned(baton->val.size);
+  } else {
+    argv[1] = v8::Undefined();
+  }
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
+
+int Db::EIO_GetMany(eio_req *req) {
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
+  if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
+    return 0;
+
+  Db *dbObj = dynamic_cast<Db *>(baton->object);
+  DB *&db = dbObj->_db;
+  size_t count = baton->keys.size();
+  size_t i = 0;
+  size_t n = 0;
+  int rc = 0;
+  DBC *cursor = NULL;
+  DBT val = {0};
+
+  std::vector<size_t> order(count);
+  for (i = 0; i < count; i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), KeyOrder(baton->keys));
+
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  baton->out.length = 0;
+  baton->out.offsets.assign(count * 2, 0);
+  baton->codes.assign(count, 0);
+
+  rc = db->cursor(db, _txn, &cursor, baton->txnFlags & READ_ISOLATION);
+  if (rc != 0)
+    goto error;
+
+  for (i = 0; i < count; i++) {
+    n = order[i];
+    for (;;) {
+      memset(&val, 0, sizeof(DBT));
+      val.flags = DB_DBT_USERMEM;
+      val.data = baton->out.data + baton->out.length;
+      val.ulen = baton->out.capacity - baton->out.length;
+      rc = cursor->get(cursor, &(baton->keys[n]), &val,
+                       DB_SET | baton->flags);
+      if (rc != DB_BUFFER_SMALL)
+        break;
+      if (!baton->out.reserve(val.size)) {
+        rc = ENOMEM;
+        break;
+      }
+    }
+
+    if (rc == 0 && dbObj->_codec != NULL) {
+      // Swap the encoded value we just read for the decoded one
+      DBT raw;
+      rc = dbObj->_codec->decode(&val, &raw);
+      if (rc == 0) {
+        if (baton->out.reserve(raw.size)) {
+          memcpy(baton->out.data + baton->out.length, raw.data, raw.size);
+          val.size = raw.size;
+        } else {
+          rc = ENOMEM;
+        }
+        free(raw.data);
+      }
+    }
+
+    if (rc == 0) {
+      baton->out.offsets[n * 2] = baton->out.length;
+      baton->out.offsets[n * 2 + 1] = val.size;
+      baton->out.length += val.size;
+    } else if (rc == DB_NOTFOUND || rc == DB_KEYEMPTY) {
+      baton->codes[n] = rc;
+      rc = 0;
+    } else {
+      break;
+    }
+  }
+
+ error:
+  if (cursor != NULL) {
+    int t_rc = cursor->close(cursor);
+    if (rc == 0)
+      rc = t_rc;
+    cursor = NULL;
+  }
+  baton->status = rc;
+  TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  return 0;
+}
+
+int Db::EIO_AfterGetMany(eio_req *req) {
+  v8::HandleScope scope;
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
+
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
+
+  v8::Handle<v8::Value> argv[3] = {};
+  argv[0] = msg;
+  argv[1] = baton->out.buffer();
+
+  // [offset, length] per key, in the caller's order; length is -1 for
+  // keys that weren't found.
+  v8::Handle<v8::Array> offsets = baton->out.offsetArray();
+  for (size_t i = 0; i < baton->codes.size(); i++) {
+    if (baton->codes[i] != 0)
+      offsets->Set(v8::Number::New(i * 2 + 1), v8::Integer::New(-1));
+  }
+  argv[2] = offsets;
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 3, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
 
 int Db::EIO_CursorGet(eio_req *req) {
   EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
@@ -124,9 +490,25 @@ int Db::EIO_CursorGet(eio_req *req) {
   DBT *val = NULL;
   int i = 1;
 
-  TXN_BEGIN(dbObj);
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  // Every attempt (including a deferred retry) starts from scratch
+  baton->clearRecords();
+  baton->status = 0;
+  rc = 0;
+  i = 1;
+  if (key != NULL) {
+    free(key->data);
+    free(key);
+    key = NULL;
+  }
+  if (val != NULL) {
+    free(val->data);
+    free(val);
+    val = NULL;
+  }
 
-  rc = db->cursor(db, _txn, &cursor, 0);
+  rc = db->cursor(db, _txn, &cursor, baton->txnFlags & READ_ISOLATION);
   if (rc != 0) {
     baton->status = rc;
     goto error;
@@ -138,6 +520,8 @@ int Db::EIO_CursorGet(eio_req *req) {
   key->data = calloc(1, key->size);
   memcpy(key->data, baton->key.data, key->size);
   rc = cursor->get(cursor, key, val, baton->initFlag);
+  if (rc == 0 && dbObj->_codec != NULL)
+    rc = dbObj->_codec->decodeOwned(val);
   if (rc != 0) {
     baton->status = rc;
     goto error;
@@ -148,26 +532,42 @@ int Db::EIO_CursorGet(eio_req *req) {
   ALLOC_DBT(val);
   while ((i++ < baton->limit) &&
          (rc = cursor->get(cursor, key, val, baton->flags)) == 0) {
+    if (dbObj->_codec != NULL &&
+        (rc = dbObj->_codec->decodeOwned(val)) != 0) {
+      baton->status = rc;
+      break;
+    }
     baton->records.push_back(std::make_pair(key, val));
     ALLOC_DBT(key);
     ALLOC_DBT(val);
   }
+  // Running off the end is fine; anything else (a deadlock mid-scan, say)
+  // has to abort the txn rather than pass off what we got as the result
+  if (rc != 0 && rc != DB_NOTFOUND && baton->status == 0)
+    baton->status = rc;
 
  error:
   if (cursor != NULL) {
-    baton->status = cursor->close(cursor);
+    int t_rc = cursor->close(cursor);
+    if (baton->status == 0)
+      baton->status = t_rc;
     cursor = NULL;
   }
   TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
   // These get alloc'd once more than we need...
   if (key != NULL) {
+    free(key->data);
     free(key);
     key = NULL;
   }
   if (val != NULL) {
+    free(val->data);
     free(val);
     val = NULL;
   }
+  if (baton->status != 0)
+    baton->clearRecords();
   if (baton->status == 0 && rc == DB_NOTFOUND) {
     baton->status = DB_NOTFOUND;
   }
@@ -177,7 +577,6 @@ int Db::EIO_CursorGet(eio_req *req) {
 int Db::EIO_AfterCursorGet(eio_req *req) {
   v8::HandleScope scope;
   EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
-  ev_unref(EV_DEFAULT_UC);
 
   v8::Local<v8::Array> arr = v8::Array::New(baton->records.size());
   int count = 0;
@@ -190,7 +589,7 @@ int Db::EIO_AfterCursorGet(eio_req *req) {
     i++;
   }
 
-  DB_RES(baton->status, db_strerror(baton->status), msg);
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
   v8::Handle<v8::Value> argv[2] = {};
   argv[0] = msg;
   argv[1] = arr;
@@ -208,6 +607,130 @@ int Db::EIO_AfterCursorGet(eio_req *req) {
   return 0;
 }
 
+int Db::EIO_CursorGetBulk(eio_req *req) {
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
+  if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
+    return 0;
+
+  Db *dbObj = dynamic_cast<Db *>(baton->object);
+  DB *&db = dbObj->_db;
+  DBT &start = baton->keys[0];
+  int rc = 0;
+  int op = 0;
+  int count = 0;
+  u_int32_t pgsize = 0;
+  u_int32_t klen = 0;
+  u_int32_t vlen = 0;
+  void *p = NULL;
+  void *k = NULL;
+  void *v = NULL;
+  DBC *cursor = NULL;
+  DBT key = {0};
+  DBT bulk = {0};
+  memset(&bulk, 0, sizeof(DBT));
+
+  // DB_MULTIPLE_KEY buffers must be a multiple of 1KB and hold a page.
+  if (db->get_pagesize(db, &pgsize) != 0)
+    pgsize = 0;
+  bulk.ulen = baton->bufferSize > pgsize ? baton->bufferSize : pgsize;
+  bulk.ulen = (bulk.ulen + 1023) & ~1023;
+  bulk.flags = DB_DBT_USERMEM;
+  bulk.data = malloc(bulk.ulen);
+  if (bulk.data == NULL) {
+    baton->status = ENOMEM;
+    return 0;
+  }
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  baton->out.length = 0;
+  baton->out.offsets.clear();
+  count = 0;
+  op = baton->initFlag;
+
+  rc = db->cursor(db, _txn, &cursor, baton->txnFlags & READ_ISOLATION);
+  if (rc != 0)
+    goto error;
+
+  while (count < baton->limit) {
+    memset(&key, 0, sizeof(DBT));
+    key.data = start.data;
+    key.size = start.size;
+    rc = cursor->get(cursor, &key, &bulk, op | DB_MULTIPLE_KEY);
+    if (rc == DB_BUFFER_SMALL) {
+      // A single record didn't fit; make room and ask again
+      void *bigger = realloc(bulk.data, (bulk.size + 1023) & ~1023);
+      if (bigger == NULL) {
+        rc = ENOMEM;
+        break;
+      }
+      bulk.data = bigger;
+      bulk.ulen = (bulk.size + 1023) & ~1023;
+      continue;
+    }
+    if (rc != 0)
+      break;
+
+    DB_MULTIPLE_INIT(p, &bulk);
+    while (count < baton->limit) {
+      DB_MULTIPLE_KEY_NEXT(p, &bulk, k, klen, v, vlen);
+      if (p == NULL)
+        break;
+      if (!baton->out.reserve(klen) || !baton->out.append(k, klen)) {
+        rc = ENOMEM;
+        goto error;
+      }
+      rc = AppendValue(dbObj->_codec, &(baton->out), v, vlen);
+      if (rc != 0)
+        goto error;
+      count++;
+    }
+    op = baton->flags;
+  }
+
+ error:
+  if (cursor != NULL) {
+    int t_rc = cursor->close(cursor);
+    if (rc == 0 || rc == DB_NOTFOUND)
+      rc = (t_rc != 0) ? t_rc : rc;
+    cursor = NULL;
+  }
+  baton->status = (rc == DB_NOTFOUND) ? 0 : rc;
+  TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+  if (baton->status == 0 && rc == DB_NOTFOUND)
+    baton->status = DB_NOTFOUND;
+
+  free(bulk.data);
+  bulk.data = NULL;
+
+  return 0;
+}
+
+int Db::EIO_AfterCursorGetBulk(eio_req *req) {
+  v8::HandleScope scope;
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
+
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
+
+  // [key offset, key length, value offset, value length] per record
+  v8::Handle<v8::Value> argv[3] = {};
+  argv[0] = msg;
+  argv[1] = baton->out.buffer();
+  argv[2] = baton->out.offsetArray();
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 3, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
 int Db::EIO_Put(eio_req *req) {
   EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
   if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
@@ -216,15 +739,66 @@ int Db::EIO_Put(eio_req *req) {
   Db *dbObj = dynamic_cast<Db *>(baton->object);
   DB *&db = dbObj->_db;
 
-  TXN_BEGIN(dbObj);
+  DBT stored = baton->val;
+  if (dbObj->_codec != NULL) {
+    baton->status = dbObj->_codec->encode(&(baton->val), &stored);
+    if (baton->status != 0)
+      return 0;
+  }
+
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
 
-  baton->status = db->put(db, _txn, &(baton->key), &(baton->val), baton->flags);
+  baton->status = db->put(db, _txn, &(baton->key), &stored, baton->flags);
 
   TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  if (dbObj->_codec != NULL)
+    free(stored.data);
 
   return 0;
 }
 
+// The value putIf() found, against the one it was told to expect: 0 if
+// they match, -2 if not (or a decode error).  oldVal is ours (malloc'd).
+static int CheckOldValue(Codec *codec, DBT *oldVal, const DBT *expected) {
+  int rc = 0;
+  if (codec != NULL && (rc = codec->decodeOwned(oldVal)) != 0)
+    return rc;
+  if (oldVal->size != expected->size ||
+      memcmp(oldVal->data, expected->data, oldVal->size) != 0)
+    return -2;
+  return 0;
+}
+
+// putIf() in a CDB environment.  Without txns, a get and then a put would
+// let another writer in between; a write cursor holds CDB's one write
+// lock across both.
+static int PutIfWriteCursor(DB *db, Codec *codec, DBT *key, DBT *stored,
+                            const DBT *expected) {
+  DBC *cursor = NULL;
+  DBT oldVal = {0};
+  memset(&oldVal, 0, sizeof(DBT));
+  oldVal.flags = DB_DBT_MALLOC;
+
+  int rc = db->cursor(db, NULL, &cursor, DB_WRITECURSOR);
+  if (rc != 0)
+    return rc;
+
+  rc = cursor->get(cursor, key, &oldVal, DB_SET);
+  if (rc == 0)
+    rc = CheckOldValue(codec, &oldVal, expected);
+  if (rc == 0)
+    rc = cursor->put(cursor, key, stored, DB_CURRENT);
+
+  int ret = cursor->close(cursor);
+  if (rc == 0)
+    rc = ret;
+  if (oldVal.data != NULL)
+    free(oldVal.data);
+  return rc;
+}
+
 int Db::EIO_PutIf(eio_req *req) {
   EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
   if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
@@ -235,71 +809,533 @@ int Db::EIO_PutIf(eio_req *req) {
   DBT oldVal = {0};
   memset(&oldVal, 0, sizeof(DBT));
   oldVal.flags = DB_DBT_MALLOC;
+  DBT stored = baton->val;
+  if (dbObj->_codec != NULL) {
+    baton->status = dbObj->_codec->encode(&(baton->val), &stored);
+    if (baton->status != 0)
+      return 0;
+  }
+
+  if (dbObj->_concurrent) {
+    baton->status = PutIfWriteCursor(db, dbObj->_codec, &(baton->key),
+                                     &stored, &(baton->oldVal));
+    if (dbObj->_codec != NULL)
+      free(stored.data);
+    return 0;
+  }
 
-  TXN_BEGIN(dbObj);
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
 
-  baton->status = db->get(db, _txn, &(baton->key), &oldVal, 0);
-  if (baton->status == 0) {
-    if (oldVal.size != baton->oldVal.size) {
-      baton->status = -2;
-      goto error;
-    }
-    if (memcmp(oldVal.data, baton->oldVal.data, oldVal.size) != 0) {
-      baton->status = -2;
-      goto error;
-    }
-    baton->status = db->put(db, _txn, &(baton->key), &(baton->val),
-                            baton->flags);
+  if (oldVal.data != NULL) {
+    free(oldVal.data);
+    oldVal.data = NULL;
   }
 
- error:
+  baton->status = db->get(db, _txn, &(baton->key), &oldVal, 0);
+  if (baton->status == 0)
+    baton->status = CheckOldValue(dbObj->_codec, &oldVal, &(baton->oldVal));
+  if (baton->status == 0)
+    baton->status = db->put(db, _txn, &(baton->key), &stored, baton->flags);
+
   TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
 
   if (oldVal.data != NULL) {
     free(oldVal.data);
     oldVal.data = NULL;
   }
+  if (dbObj->_codec != NULL)
+    free(stored.data);
 
   return 0;
 }
 
-int Db::EIO_Del(eio_req *req) {
-  EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
+int Db::EIO_PutMany(eio_req *req) {
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
   if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
     return 0;
 
   Db *dbObj = dynamic_cast<Db *>(baton->object);
   DB *&db = dbObj->_db;
+  size_t count = baton->keys.size();
+  size_t i = 0;
+  int rc = 0;
+  void *p = NULL;
+  DBT bulk = {0};
+  DBT empty = {0};
+  memset(&bulk, 0, sizeof(DBT));
+  memset(&empty, 0, sizeof(DBT));
+
+  // With a codec we put encoded copies of the values instead
+  std::vector<DBT> encoded;
+  if (dbObj->_codec != NULL) {
+    encoded.resize(count);
+    for (i = 0; i < count; i++) {
+      rc = dbObj->_codec->encode(&(baton->vals[i]), &(encoded[i]));
+      if (rc != 0) {
+        for (size_t j = 0; j < i; j++)
+          free(encoded[j].data);
+        baton->status = rc;
+        return 0;
+      }
+    }
+  }
+  std::vector<DBT> &vals = encoded.empty() ? baton->vals : encoded;
+
+  // DB_MULTIPLE_KEY can't honor per-op flags like DB_NOOVERWRITE, so the
+  // per-record mode issues one put per record (still in one transaction).
+  if (!baton->perRecord) {
+    // Every pair costs 4 offset/length words, plus the -1 terminator.
+    size_t ulen = sizeof(u_int32_t);
+    for (i = 0; i < count; i++) {
+      ulen += baton->keys[i].size + vals[i].size + 4 * sizeof(u_int32_t);
+    }
+    ulen = (ulen + sizeof(u_int32_t) - 1) & ~(sizeof(u_int32_t) - 1);
+
+    bulk.data = malloc(ulen);
+    if (bulk.data == NULL) {
+      for (i = 0; i < encoded.size(); i++)
+        free(encoded[i].data);
+      baton->status = ENOMEM;
+      return 0;
+    }
+    bulk.ulen = ulen;
+    bulk.flags = DB_DBT_USERMEM;
+
+    DB_MULTIPLE_WRITE_INIT(p, &bulk);
+    for (i = 0; i < count && p != NULL; i++) {
+      DB_MULTIPLE_KEY_WRITE_NEXT(p, &bulk,
+                                 baton->keys[i].data, baton->keys[i].size,
+                                 vals[i].data, vals[i].size);
+    }
+    if (p == NULL) {
+      free(bulk.data);
+      for (i = 0; i < encoded.size(); i++)
+        free(encoded[i].data);
+      baton->status = EINVAL;
+      return 0;
+    }
+  }
 
-  TXN_BEGIN(dbObj);
-
-  baton->status = db->del(db, _txn, &(baton->key), baton->flags);
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  baton->status = 0;
+  if (baton->perRecord) {
+    baton->codes.assign(count, 0);
+    for (i = 0; i < count; i++) {
+      rc = db->put(db, _txn, &(baton->keys[i]), &(vals[i]), baton->flags);
+      baton->codes[i] = rc;
+      // A key that already exists is a per-record result; anything else
+      // fails (and aborts) the whole batch.
+      if (rc != 0 && rc != DB_KEYEXIST) {
+        baton->status = rc;
+        break;
+      }
+    }
+  } else {
+    bulk.doff = 0;
+    baton->status = db->put(db, _txn, &bulk, &empty,
+                            baton->flags | DB_MULTIPLE_KEY);
+  }
 
   TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  if (bulk.data != NULL) {
+    free(bulk.data);
+    bulk.data = NULL;
+  }
+  for (i = 0; i < encoded.size(); i++)
+    free(encoded[i].data);
 
   return 0;
 }
 
-// Start V8 Exposed Methods
-
-v8::Handle<v8::Value> Db::OpenS(const v8::Arguments& args) {
+int Db::EIO_AfterPutMany(eio_req *req) {
   v8::HandleScope scope;
+  EIOBulkBaton *baton = static_cast<EIOBulkBaton *>(req->data);
 
-  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
 
-  REQ_STR_ARG(0, file);
+  v8::Handle<v8::Value> argv[2] = {};
+  argv[0] = msg;
+  if (baton->perRecord) {
+    v8::Local<v8::Array> codes = v8::Array::New(baton->codes.size());
+    for (size_t i = 0; i < baton->codes.size(); i++)
+      codes->Set(v8::Number::New(i), v8::Integer::New(baton->codes[i]));
+    argv[1] = codes;
+  } else {
+    argv[1] = v8::Undefined();
+  }
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
+// Checked and counted under _groupLock, so closeSync() can wait for us
+// and we never see a half-closed handle.  A group that shows up after the
+// close (e.g. back from a retry backoff) fails; it never reports success.
+int Db::EIO_PutGroup(eio_req *req) {
+  EIOGroupBaton *baton = static_cast<EIOGroupBaton *>(req->data);
+  Db *dbObj = dynamic_cast<Db *>(baton->object);
+
+  pthread_mutex_lock(&(dbObj->_groupLock));
+  if (dbObj->_db == NULL) {
+    pthread_mutex_unlock(&(dbObj->_groupLock));
+    for (size_t i = 0; i < baton->ops.size(); i++)
+      baton->ops[i]->status = EINVAL;
+    return 0;
+  }
+  dbObj->_groupsRunning++;
+  pthread_mutex_unlock(&(dbObj->_groupLock));
+
+  dbObj->writeGroup(baton);
+
+  pthread_mutex_lock(&(dbObj->_groupLock));
+  if (--dbObj->_groupsRunning == 0)
+    pthread_cond_broadcast(&(dbObj->_groupIdle));
+  pthread_mutex_unlock(&(dbObj->_groupLock));
+
+  return 0;
+}
+
+// Already written by closeSync(); just the callbacks are left
+int Db::EIO_GroupWritten(eio_req *req) {
+  return 0;
+}
+
+void Db::writeGroup(EIOGroupBaton *baton) {
+  Db *dbObj = this;
+  DB *&db = _db;
+  size_t i = 0;
+  int rc = 0;
+
+  // Not an op of its own; AfterPutGroup hands these to each put.  A
+  // deferred retry runs this again, so keep the first start.
+  if (baton->timing.started == 0)
+    baton->timing.started = LatencyStats::Now();
+
+  // Encode up front, so a deadlock retry doesn't do it all over again
+  std::vector<DBT> stored(baton->ops.size());
+  for (i = 0; i < baton->ops.size(); i++) {
+    stored[i] = baton->ops[i]->val;
+    if (dbObj->_codec != NULL &&
+        (rc = dbObj->_codec->encode(&(baton->ops[i]->val), &stored[i])) != 0) {
+      for (size_t j = 0; j < i; j++)
+        free(stored[j].data);
+      for (i = 0; i < baton->ops.size(); i++)
+        baton->ops[i]->status = rc;
+      return;
+    }
+  }
+
+  TXN_BEGIN_RETRY(dbObj, NULL, &(baton->retry), 0);
+
+  baton->status = 0;
+  for (i = 0; i < baton->ops.size(); i++) {
+    EIODbBaton *op = baton->ops[i];
+    rc = db->put(db, _txn, &(op->key), &stored[i], op->flags);
+    op->status = rc;
+    // A failed put (DB_KEYEXIST, ...) is that op's answer alone; only
+    // errors that doom the txn take the whole group down with them.
+    if (rc == DB_LOCK_DEADLOCK || rc == DB_LOCK_NOTGRANTED ||
+        rc == DB_RUNRECOVERY) {
+      baton->status = rc;
+      break;
+    }
+  }
+
+  TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  if (baton->status != 0) {
+    for (i = 0; i < baton->ops.size(); i++)
+      baton->ops[i]->status = baton->status;
+  }
+  if (dbObj->_codec != NULL) {
+    for (i = 0; i < stored.size(); i++)
+      free(stored[i].data);
+  }
+
+  baton->timing.finished = LatencyStats::Now();
+}
+
+int Db::EIO_AfterPutGroup(eio_req *req) {
+  v8::HandleScope scope;
+  EIOGroupBaton *baton = static_cast<EIOGroupBaton *>(req->data);
+
+  // Nobody hears back until the shared commit is done.
+  LatencyStats *latency = baton->object->_latency;
+  for (size_t i = 0; i < baton->ops.size(); i++) {
+    EIODbBaton *op = baton->ops[i];
+
+    // Each put waited in the group, then ran with the rest of it
+    if (latency != NULL) {
+      op->timing.started = baton->timing.started;
+      op->timing.finished = baton->timing.finished;
+      op->timing.retries = baton->timing.retries;
+      latency->recordWork(op->timing);
+      latency->recordComplete(op->timing);
+    }
+
+    v8::Local<v8::Object> msg = StatusObject(op->status);
+    v8::Local<v8::Value> argv[1] = { msg };
+
+    v8::TryCatch try_catch;
+
+    op->cb->Call(v8::Context::GetCurrent()->Global(), 1, argv);
+
+    if (try_catch.HasCaught())
+      node::FatalException(try_catch);
+
+    op->object->Unref();
+    delete op;
+  }
+
+  delete baton;
+  return 0;
+}
+
+int Db::EIO_Del(eio_req *req) {
+  EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
+  if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
+    return 0;
+
+  Db *dbObj = dynamic_cast<Db *>(baton->object);
+  DB *&db = dbObj->_db;
+
+  TXN_BEGIN_RETRY(dbObj, baton->txn, &(baton->retry), baton->txnFlags);
+
+  baton->status = db->del(db, _txn, &(baton->key), baton->flags);
+
+  TXN_END(dbObj, baton->status);
+  baton->timing.retries = _retryState->attempts;
+
+  return 0;
+}
+
+// A full stat walks every page of the database, so it doesn't get a
+// transaction of its own (that would hold read locks the whole way);
+// DB_FAST_STAT just reads the metadata page.
+int Db::EIO_Stat(eio_req *req) {
+  EIOStatBaton *baton = static_cast<EIOStatBaton *>(req->data);
+  if (baton->object == NULL || dynamic_cast<Db *>(baton->object)->_db == NULL)
+    return 0;
+
+  DB *&db = dynamic_cast<Db *>(baton->object)->_db;
+
+  DB_TXN *txn = NULL;
+  if (baton->txn != NULL) {
+    baton->txn->lock();
+    txn = baton->txn->getDB_TXN();
+  }
+  baton->status = db->get_type(db, &(baton->type));
+  if (baton->status == 0)
+    baton->status = db->stat(db, txn, &(baton->sp), baton->flags);
+  if (baton->txn != NULL)
+    baton->txn->unlock();
+
+  return 0;
+}
+
+int Db::EIO_AfterStat(eio_req *req) {
+  v8::HandleScope scope;
+  EIOStatBaton *baton = static_cast<EIOStatBaton *>(req->data);
+
+  v8::Handle<v8::Value> argv[2] = {};
+  argv[0] = StatusObject(baton->status);
+  if (baton->status == 0) {
+    argv[1] = DbStatObject(baton->type, baton->sp);
+  } else {
+    argv[1] = v8::Undefined();
+  }
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
+// Start group commit
+
+void Db::GroupTimeout(EV_P_ ev_timer *w, int revents) {
+  Db *db = static_cast<Db *>(w->data);
+  db->flushGroup();
+}
+
+void Db::queueGroupPut(EIODbBaton *baton) {
+  if (_group == NULL)
+    _group = new EIOGroupBaton(this);
+  _group->ops.push_back(baton);
+
+  if (_group->ops.size() >= static_cast<size_t>(_groupMax)) {
+    flushGroup();
+  } else if (!ev_is_active(&_groupTimer)) {
+    ev_timer_set(&_groupTimer, _groupWindow / 1000000.0, 0.);
+    ev_timer_start(EV_DEFAULT_UC_ &_groupTimer);
+  }
+}
+
+void Db::flushGroup() {
+  ev_timer_stop(EV_DEFAULT_UC_ &_groupTimer);
+  if (_group == NULL)
+    return;
+
+  EIOGroupBaton *group = _group;
+  _group = NULL;
+  WorkerPool::Submit(_queue, EIO_PutGroup, EIO_AfterPutGroup, group);
+}
+
+// Start key gate
+
+// Auto-commit writes go through the gate, if there is one; writes in a
+// caller's txn don't (their locks outlive the op, so holding the stripe
+// wouldn't keep anyone out of BDB anyway).
+void Db::submitWrite(EIODbBaton *baton, WorkFn execute, bool mergeable) {
+  if (holdWrite(baton, execute, EIO_After_ReturnStatus, true, mergeable))
+    return;
+
+  if (_gate == NULL || baton->txn != NULL) {
+    WorkerPool::Submit(_queue, execute, EIO_After_ReturnStatus, baton);
+    return;
+  }
+
+  // With duplicates, a put adds a record instead of replacing one
+  u_int32_t dbFlags = 0;
+  if (mergeable && _db != NULL && _db->get_flags(_db, &dbFlags) == 0 &&
+      (dbFlags & (DB_DUP | DB_DUPSORT)) != 0)
+    mergeable = false;
+
+  baton->stripe = _gate->stripe(&(baton->key));
+  GatedOp *op = new GatedOp(baton, execute, EIO_After_ReturnStatus,
+                            &(baton->key), mergeable);
+  if (_gate->enter(baton->stripe, op))
+    WorkerPool::Submit(_queue, execute, EIO_AfterGated, baton);
+}
+
+int Db::EIO_AfterGated(eio_req *req) {
+  EIODbBaton *baton = static_cast<EIODbBaton *>(req->data);
+  Db *db = dynamic_cast<Db *>(baton->object);
+
+  // Let the next write on this stripe in before anyone hears back, so a
+  // callback that writes the same key again lines up behind it.
+  GatedOp *next = NULL;
+  GatedOp *done = db->_gate->leave(baton->stripe, &next);
+  if (next != NULL)
+    WorkerPool::Submit(db->_queue, next->execute, EIO_AfterGated,
+                       next->baton);
+
+  // Older puts this one replaced get its answer, oldest first
+  for (size_t i = 0; i < done->merged.size(); i++) {
+    eio_req merged;
+    memset(&merged, 0, sizeof(eio_req));
+    merged.data = done->merged[i];
+    done->merged[i]->status = baton->status;
+    done->finish(&merged);
+  }
+
+  WorkFn finish = done->finish;
+  delete done;
+  return finish(req);
+}
+
+// Start CDB write hold
+
+// In a CDB env an open Cursor holds the database's read lock across JS
+// callbacks, and a write blocks in BDB (on a worker, with no deadlock
+// detection to get it out) until every cursor is closed.  Enough of those
+// would tie up every worker, the one the cursor needs to move on
+// included.  So while a cursor is open, async writes wait here instead,
+// on the main thread, and go to the pool in order once the last one
+// closes.  Returns true if the write was held.
+bool Db::holdWrite(EIOBaton *baton, WorkFn execute, WorkFn finish,
+                   bool gated, bool mergeable) {
+  if (_cursors == 0)
+    return false;
+
+  HeldWrite held = { baton, execute, finish, gated, mergeable };
+  _held.push_back(held);
+  return true;
+}
+
+void Db::cursorOpened() {
+  if (_concurrent)
+    _cursors++;
+}
+
+void Db::cursorClosed() {
+  if (!_concurrent || --_cursors > 0)
+    return;
+
+  std::deque<HeldWrite> held;
+  held.swap(_held);
+  for (size_t i = 0; i < held.size(); i++) {
+    if (held[i].gated) {
+      submitWrite(static_cast<EIODbBaton *>(held[i].baton), held[i].execute,
+                  held[i].mergeable);
+    } else {
+      WorkerPool::Submit(_queue, held[i].execute, held[i].finish,
+                         held[i].baton);
+    }
+  }
+}
+
+// Closing the Db under an open cursor: the held writes never ran, so they
+// fail, rather than waiting for a handle that's gone.
+void Db::refuseHeldWrites() {
+  std::deque<HeldWrite> held;
+  held.swap(_held);
+  for (size_t i = 0; i < held.size(); i++) {
+    held[i].baton->status = EINVAL;
+    WorkerPool::Submit(_queue, EIO_Refused, held[i].finish, held[i].baton);
+  }
+}
+
+// Already answered on the main thread; just the callback is left
+int Db::EIO_Refused(eio_req *req) {
+  return 0;
+}
+
+// Start V8 Exposed Methods
+
+v8::Handle<v8::Value> Db::OpenS(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  // No file means an in-memory database
+  OPT_STR_ARG(0, file);
   REQ_INT_ARG(1, type);
   REQ_INT_ARG(2, flags);
   REQ_INT_ARG(3, mode);
   REQ_INT_ARG(4, retries);
 
-  db->_retries = retries;
+  db->_retry.retries = retries;
+  // BDB refuses DB_AUTO_COMMIT outright without DB_INIT_TXN (e.g. CDB)
+  if (!db->_transactional)
+    flags &= ~DB_AUTO_COMMIT;
 
   int rc = -1;
   if (db->_db != NULL) {
     rc = db->_db->open(db->_db,
                        NULL,  // TODO(mcavage): support DB open as TXN
-                       *file,
+                       file,
                        NULL,  // db
                        static_cast<DBTYPE>(type),
                        flags,
@@ -317,8 +1353,35 @@ v8::Handle<v8::Value> Db::CloseS(const v8::Arguments& args) {
 
   REQ_INT_ARG(0, flags);
 
-  int rc = db->_db->close(db->_db, flags);
+  db->refuseHeldWrites();
+
+  // Whatever is still waiting for the group window gets written now (no
+  // deferred retries; we're about to close), and its callbacks run as
+  // usual, off the pool.
+  ev_timer_stop(EV_DEFAULT_UC_ &(db->_groupTimer));
+  if (db->_group != NULL) {
+    EIOGroupBaton *group = db->_group;
+    db->_group = NULL;
+    group->retry.deferrable = false;
+    if (db->_db != NULL) {
+      db->writeGroup(group);
+    } else {
+      for (size_t i = 0; i < group->ops.size(); i++)
+        group->ops[i]->status = EINVAL;
+    }
+    WorkerPool::Submit(db->_queue, EIO_GroupWritten, EIO_AfterPutGroup, group);
+  }
+
+  // And a group already on a worker finishes before the handle goes
+  pthread_mutex_lock(&(db->_groupLock));
+  while (db->_groupsRunning > 0)
+    pthread_cond_wait(&(db->_groupIdle), &(db->_groupLock));
+  int rc = EINVAL;
+  if (db->_db != NULL)
+    rc = db->_db->close(db->_db, flags);
   db->_db = NULL;
+  pthread_mutex_unlock(&(db->_groupLock));
+
   DB_RES(rc, db_strerror(rc), msg);
   return msg;
 }
@@ -336,6 +1399,10 @@ v8::Handle<v8::Value> Db::AssociateS(const v8::Arguments &args) {
   DB *&_db = db->_db;
   DB *&_sdb = sdb->_db;
 
+  // The key callback runs inside BDB, so it would see encoded values
+  if (db->_codec != NULL || sdb->_codec != NULL)
+    RET_EXC("associate can't be used with a value codec");
+
   void *handle = dlopen(*lib, RTLD_NOW | RTLD_LOCAL);
   if (handle == NULL) {
     DB_RES(-1, dlerror(), _msg);
@@ -353,6 +1420,10 @@ v8::Handle<v8::Value> Db::AssociateS(const v8::Arguments &args) {
   // We don't dlclose...that's lame, but the OS will do it :-)
 
   int rc = _db->associate(_db, NULL, _sdb, callback, flags);
+  if (rc == 0) {
+    db->_associated = true;
+    sdb->_associated = true;
+  }
   DB_RES(rc, db_strerror(rc), msg);
   return msg;
 }
@@ -363,23 +1434,63 @@ v8::Handle<v8::Value> Db::CursorGet(const v8::Arguments& args) {
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_INT_ARG(1, limit);
-  REQ_INT_ARG(2, initFlag);
-  REQ_INT_ARG(3, flags);
-  REQ_FN_ARG(4, cb);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, limit);
+  REQ_INT_ARG(3, initFlag);
+  REQ_INT_ARG(4, flags);
+  REQ_INT_ARG(5, txnFlags);
+  REQ_FN_ARG(6, cb);
 
   EIODbBaton *baton = new EIODbBaton(db);
   baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
   baton->limit = limit;
   baton->initFlag = initFlag;
   baton->flags = flags;
+  baton->txnFlags = txnFlags;
   baton->key.data = key;
   baton->key.size = key_len;
 
   db->Ref();
-  eio_custom(EIO_CursorGet, EIO_PRI_DEFAULT, EIO_AfterCursorGet, baton);
-  ev_ref(EV_DEFAULT_UC);
+  baton->timing.submit(OP_CURSOR);
+  WorkerPool::Submit(db->_queue, EIO_CursorGet, EIO_AfterCursorGet, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::CursorGetBulk(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, limit);
+  REQ_INT_ARG(3, initFlag);
+  REQ_INT_ARG(4, flags);
+  REQ_INT_ARG(5, txnFlags);
+  REQ_INT_ARG(6, bufferSize);
+  REQ_FN_ARG(7, cb);
+
+  EIOBulkBaton *baton = new EIOBulkBaton(db);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->records = v8::Persistent<v8::Object>::New(_key);
+  baton->limit = limit;
+  baton->initFlag = initFlag;
+  baton->flags = flags;
+  baton->txnFlags = txnFlags;
+  baton->bufferSize = bufferSize > 0 ? bufferSize : 0;
+  baton->keys.resize(1);
+  memset(&(baton->keys[0]), 0, sizeof(DBT));
+  baton->keys[0].data = key;
+  baton->keys[0].size = key_len;
+
+  db->Ref();
+  baton->timing.submit(OP_CURSOR);
+  WorkerPool::Submit(db->_queue, EIO_CursorGetBulk, EIO_AfterCursorGetBulk,
+                     baton);
 
   return v8::Undefined();
 }
@@ -389,10 +1500,12 @@ v8::Handle<v8::Value> Db::CursorGetS(const v8::Arguments& args) {
 
   Db* dbObj = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, _key);
-  REQ_INT_ARG(1, limit);
-  REQ_INT_ARG(2, initFlag);
-  REQ_INT_ARG(3, flags);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, _key);
+  REQ_INT_ARG(2, limit);
+  REQ_INT_ARG(3, initFlag);
+  REQ_INT_ARG(4, flags);
+  REQ_INT_ARG(5, txnFlags);
 
   DB *&db = dbObj->_db;
   int rc = 0;
@@ -405,9 +1518,15 @@ v8::Handle<v8::Value> Db::CursorGetS(const v8::Arguments& args) {
   v8::Local<v8::Object> v8Obj;
   bool last = false;
 
-  TXN_BEGIN(dbObj);
+  TXN_BEGIN_FLAGS(dbObj, txn, txnFlags);
+
+  // A retry starts over
+  arr = v8::Array::New();
+  count = 0;
+  i = 1;
+  last = false;
 
-  rc = db->cursor(db, _txn, &cursor, 0);
+  rc = db->cursor(db, _txn, &cursor, txnFlags & READ_ISOLATION);
   if (rc != 0) goto error;
 
   memset(&key, 0, sizeof(DBT));
@@ -419,23 +1538,31 @@ v8::Handle<v8::Value> Db::CursorGetS(const v8::Arguments& args) {
   rc = cursor->get(cursor, &key, &val, initFlag);
   if (rc != 0) goto error;
 
-  ADD_CURSOR_RECORD((&key), (&val), v8Obj, arr, count++);
-  memset(&key, 0, sizeof(DBT));
-  memset(&val, 0, sizeof(DBT));
-
-  while ((i++ < limit) && (rc = cursor->get(cursor, &key, &val, flags)) == 0) {
-    ADD_CURSOR_RECORD((&key), (&val), v8Obj, arr, count++);
+  do {
+    if (dbObj->_codec != NULL) {
+      DBT raw;
+      rc = dbObj->_codec->decode(&val, &raw);
+      if (rc != 0) goto error;
+      ADD_CURSOR_RECORD((&key), (&raw), v8Obj, arr, count++);
+      free(raw.data);
+    } else {
+      ADD_CURSOR_RECORD((&key), (&val), v8Obj, arr, count++);
+    }
     memset(&key, 0, sizeof(DBT));
     memset(&val, 0, sizeof(DBT));
-  }
+  } while ((i++ < limit) &&
+           (rc = cursor->get(cursor, &key, &val, flags)) == 0);
 
   if (rc == DB_NOTFOUND) {
     last = true;
   }
 
  error:
+  // A real error (a deadlock mid-scan, say) has to abort the txn
   if (cursor != NULL) {
-    rc = cursor->close(cursor);
+    int t_rc = cursor->close(cursor);
+    if (rc == 0 || rc == DB_NOTFOUND)
+      rc = t_rc;
     cursor = NULL;
   }
   TXN_END(dbObj, rc);
@@ -454,19 +1581,135 @@ v8::Handle<v8::Value> Db::Get(const v8::Arguments& args) {
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_INT_ARG(1, flags);
-  REQ_FN_ARG(2, cb);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, flags);
+  REQ_INT_ARG(3, txnFlags);
+  REQ_FN_ARG(4, cb);
+
+  EIODbBaton *baton = new EIODbBaton(db);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->flags = flags;
+  baton->txnFlags = txnFlags;
+  baton->key.data = key;
+  baton->key.size = key_len;
+
+  db->Ref();
+  baton->timing.submit(OP_GET);
+  WorkerPool::Submit(db->_queue, EIO_Get, EIO_AfterGet, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::GetRange(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, offset);
+  REQ_INT_ARG(3, length);
+  REQ_INT_ARG(4, flags);
+  REQ_INT_ARG(5, txnFlags);
+  REQ_FN_ARG(6, cb);
+
+  if (offset < 0 || length < 0)
+    RET_EXC("offset and length must be >= 0");
+  if (db->_codec != NULL)
+    RET_EXC("partial reads can't be used with a value codec");
+
+  EIODbBaton *baton = new EIODbBaton(db);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->flags = flags;
+  baton->txnFlags = txnFlags;
+  baton->key.data = key;
+  baton->key.size = key_len;
+  // Only the pages holding [offset, offset + length) get read
+  baton->val.flags = DB_DBT_PARTIAL;
+  baton->val.doff = offset;
+  baton->val.dlen = length;
+
+  db->Ref();
+  baton->timing.submit(OP_GET);
+  WorkerPool::Submit(db->_queue, EIO_Get, EIO_AfterGet, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::GetInto(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_BUF_ARG(2, target);
+  REQ_INT_ARG(3, flags);
+  REQ_INT_ARG(4, txnFlags);
+  REQ_FN_ARG(5, cb);
 
   EIODbBaton *baton = new EIODbBaton(db);
   baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
   baton->flags = flags;
+  baton->txnFlags = txnFlags;
+  baton->keyHandle = v8::Persistent<v8::Object>::New(_key);
   baton->key.data = key;
   baton->key.size = key_len;
+  baton->target = v8::Persistent<v8::Object>::New(_target);
+  baton->val.data = target;
+  baton->val.ulen = target_len;
 
   db->Ref();
-  eio_custom(EIO_Get, EIO_PRI_DEFAULT, EIO_AfterGet, baton);
-  ev_ref(EV_DEFAULT_UC);
+  baton->timing.submit(OP_GET);
+  WorkerPool::Submit(db->_queue, EIO_GetInto, EIO_AfterGetInto, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::GetMany(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_ARR_ARG(1, keys);
+  REQ_INT_ARG(2, flags);
+  REQ_INT_ARG(3, txnFlags);
+  REQ_FN_ARG(5, cb);
+
+  uint32_t len = keys->Length();
+  EIOBulkBaton *baton = new EIOBulkBaton(db);
+  baton->keys.resize(len);
+  for (uint32_t i = 0; i < len; i++) {
+    v8::Local<v8::Value> k = keys->Get(i);
+    if (!node::Buffer::HasInstance(k)) {
+      delete baton;
+      RET_EXC("argument 1 must only contain buffers");
+    }
+    DBT *key = &(baton->keys[i]);
+    memset(key, 0, sizeof(DBT));
+    key->data = node::Buffer::Data(k->ToObject());
+    key->size = node::Buffer::Length(k->ToObject());
+  }
+
+  // Optional result Buffer to reuse across calls
+  if (node::Buffer::HasInstance(args[4])) {
+    baton->out.reuse(args[4]->ToObject());
+  }
+
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->records = v8::Persistent<v8::Object>::New(keys);
+  baton->flags = flags;
+  baton->txnFlags = txnFlags;
+
+  db->Ref();
+  baton->timing.submit(OP_GET);
+  WorkerPool::Submit(db->_queue, EIO_GetMany, EIO_AfterGetMany, baton);
 
   return v8::Undefined();
 }
@@ -477,23 +1720,34 @@ v8::Handle<v8::Value> Db::GetS(const v8::Arguments& args) {
   int rc = 0;
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_INT_ARG(1, flags);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, flags);
+  REQ_INT_ARG(3, txnFlags);
 
   INIT_DBT(key, key_len);
   DBT dbt_val = {0};
   memset(&dbt_val, 0, sizeof(DBT));
   dbt_val.flags = DB_DBT_MALLOC;
 
-  TXN_BEGIN(db);
+  TXN_BEGIN_FLAGS(db, txn, txnFlags);
 
-  rc = db->_db->get(db->_db, _txn, &dbt_key, &dbt_val, flags);
+  rc = db->_db->get(db->_db, _txn, &dbt_key, &dbt_val,
+                    flags | (txnFlags & READ_ISOLATION));
 
   TXN_END(db, rc);
 
+  if (rc == 0 && db->_codec != NULL)
+    rc = db->_codec->decodeOwned(&dbt_val);
+
   DB_RES(rc, db_strerror(rc), msg);
-  node::Buffer *buf = node::Buffer::New(static_cast<char *>(dbt_val.data),
-                                        dbt_val.size);
+  node::Buffer *buf = NULL;
+  if (dbt_val.data != NULL) {
+    buf = node::Buffer::New(static_cast<char *>(dbt_val.data),
+                            dbt_val.size, FreeValue, NULL);
+  } else {
+    buf = node::Buffer::New(0);
+  }
   msg->Set(val_sym, buf->handle_);
 
   return msg;
@@ -504,22 +1758,67 @@ v8::Handle<v8::Value> Db::Put(const v8::Arguments& args) {
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_BUF_ARG(1, value);
-  REQ_INT_ARG(2, flags);
-  REQ_FN_ARG(3, cb);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_BUF_ARG(2, value);
+  REQ_INT_ARG(3, flags);
+  REQ_FN_ARG(4, cb);
+
+  EIODbBaton *baton = new EIODbBaton(db);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->flags = flags;
+  baton->key.data = key;
+  baton->key.size = key_len;
+  baton->val.data = value;
+  baton->val.size = value_len;
+
+  db->Ref();
+  if (txn == NULL && db->_transactional && db->_groupMax > 1) {
+    baton->timing.submit(OP_PUT);
+    db->queueGroupPut(baton);
+  } else {
+    baton->timing.submit(OP_PUT);
+    db->submitWrite(baton, EIO_Put, flags == 0);
+  }
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::PutRange(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, offset);
+  REQ_BUF_ARG(3, value);
+  REQ_INT_ARG(4, flags);
+  REQ_FN_ARG(5, cb);
+
+  if (offset < 0)
+    RET_EXC("offset must be >= 0");
+  if (db->_codec != NULL)
+    RET_EXC("partial writes can't be used with a value codec");
 
   EIODbBaton *baton = new EIODbBaton(db);
   baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
   baton->flags = flags;
   baton->key.data = key;
   baton->key.size = key_len;
+  // Overwrite value_len bytes at offset; writing past the end extends
+  // the record (zero-filling any gap), so offset == length appends.
   baton->val.data = value;
   baton->val.size = value_len;
+  baton->val.flags = DB_DBT_PARTIAL;
+  baton->val.doff = offset;
+  baton->val.dlen = value_len;
 
   db->Ref();
-  eio_custom(EIO_Put, EIO_PRI_DEFAULT, EIO_After_ReturnStatus, baton);
-  ev_ref(EV_DEFAULT_UC);
+  baton->timing.submit(OP_PUT);
+  db->submitWrite(baton, EIO_Put, false);
 
   return v8::Undefined();
 }
@@ -528,20 +1827,39 @@ v8::Handle<v8::Value> Db::PutS(const v8::Arguments& args) {
   v8::HandleScope scope;
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
-  REQ_BUF_ARG(0, key);
-  REQ_BUF_ARG(1, val);
-  REQ_INT_ARG(2, flags);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_BUF_ARG(2, val);
+  REQ_INT_ARG(3, flags);
+
+  // CDB: this would wait, on the main thread, for a cursor that only the
+  // main thread can close
+  if (db->_cursors > 0) {
+    DB_RES(EINVAL, "a cursor is open on this database", _msg);
+    return _msg;
+  }
 
   int rc = 0;
   INIT_DBT(key, key_len);
   INIT_DBT(val, val_len);
+  DBT stored = dbt_val;
+  if (db->_codec != NULL) {
+    rc = db->_codec->encode(&dbt_val, &stored);
+    if (rc != 0) {
+      DB_RES(rc, db_strerror(rc), _msg);
+      return _msg;
+    }
+  }
 
-  TXN_BEGIN(db);
+  TXN_BEGIN(db, txn);
 
-  rc = db->_db->put(db->_db, _txn, &dbt_key, &dbt_val, flags);
+  rc = db->_db->put(db->_db, _txn, &dbt_key, &stored, flags);
 
   TXN_END(db, rc);
 
+  if (db->_codec != NULL)
+    free(stored.data);
+
   DB_RES(rc, db_strerror(rc), msg);
   return msg;
 }
@@ -552,14 +1870,16 @@ v8::Handle<v8::Value> Db::PutIf(const v8::Arguments& args) {
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_BUF_ARG(1, value);
-  REQ_BUF_ARG(2, oldValue);
-  REQ_INT_ARG(3, flags);
-  REQ_FN_ARG(4, cb);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_BUF_ARG(2, value);
+  REQ_BUF_ARG(3, oldValue);
+  REQ_INT_ARG(4, flags);
+  REQ_FN_ARG(5, cb);
 
   EIODbBaton *baton = new EIODbBaton(db);
   baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
   baton->flags = flags;
   baton->key.data = key;
   baton->key.size = key_len;
@@ -570,8 +1890,57 @@ v8::Handle<v8::Value> Db::PutIf(const v8::Arguments& args) {
   baton->oldVal.size = oldValue_len;
 
   db->Ref();
-  eio_custom(EIO_PutIf, EIO_PRI_DEFAULT, EIO_After_ReturnStatus, baton);
-  ev_ref(EV_DEFAULT_UC);
+  baton->timing.submit(OP_PUT);
+  db->submitWrite(baton, EIO_PutIf, false);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::PutMany(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_ARR_ARG(1, records);
+  REQ_INT_ARG(2, flags);
+  REQ_INT_ARG(3, perRecord);
+  REQ_FN_ARG(4, cb);
+
+  uint32_t len = records->Length();
+  if (len % 2 != 0)
+    RET_EXC("argument 1 must hold key/value pairs");
+
+  EIOBulkBaton *baton = new EIOBulkBaton(db);
+  baton->keys.resize(len / 2);
+  baton->vals.resize(len / 2);
+  for (uint32_t i = 0; i < len; i += 2) {
+    v8::Local<v8::Value> k = records->Get(i);
+    v8::Local<v8::Value> v = records->Get(i + 1);
+    if (!node::Buffer::HasInstance(k) || !node::Buffer::HasInstance(v)) {
+      delete baton;
+      RET_EXC("argument 1 must only contain buffers");
+    }
+    DBT *key = &(baton->keys[i / 2]);
+    DBT *val = &(baton->vals[i / 2]);
+    memset(key, 0, sizeof(DBT));
+    memset(val, 0, sizeof(DBT));
+    key->data = node::Buffer::Data(k->ToObject());
+    key->size = node::Buffer::Length(k->ToObject());
+    val->data = node::Buffer::Data(v->ToObject());
+    val->size = node::Buffer::Length(v->ToObject());
+  }
+
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->records = v8::Persistent<v8::Object>::New(records);
+  baton->flags = flags;
+  baton->perRecord = (perRecord != 0);
+
+  db->Ref();
+  baton->timing.submit(OP_PUT);
+  if (!db->holdWrite(baton, EIO_PutMany, EIO_AfterPutMany, false, false))
+    WorkerPool::Submit(db->_queue, EIO_PutMany, EIO_AfterPutMany, baton);
 
   return v8::Undefined();
 }
@@ -581,19 +1950,21 @@ v8::Handle<v8::Value> Db::Del(const v8::Arguments& args) {
 
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_INT_ARG(1, flags);
-  REQ_FN_ARG(2, cb);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, flags);
+  REQ_FN_ARG(3, cb);
 
   EIODbBaton *baton = new EIODbBaton(db);
   baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
   baton->flags = flags;
   baton->key.data = key;
   baton->key.size = key_len;
 
   db->Ref();
-  eio_custom(EIO_Del, EIO_PRI_DEFAULT, EIO_After_ReturnStatus, baton);
-  ev_ref(EV_DEFAULT_UC);
+  baton->timing.submit(OP_DEL);
+  db->submitWrite(baton, EIO_Del, false);
 
   return v8::Undefined();
 }
@@ -604,12 +1975,19 @@ v8::Handle<v8::Value> Db::DelS(const v8::Arguments& args) {
   int rc = 0;
   Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
 
-  REQ_BUF_ARG(0, key);
-  REQ_INT_ARG(1, flags);
+  OPT_TXN_ARG(0, txn);
+  REQ_BUF_ARG(1, key);
+  REQ_INT_ARG(2, flags);
+
+  // CDB: see PutS
+  if (db->_cursors > 0) {
+    DB_RES(EINVAL, "a cursor is open on this database", _msg);
+    return _msg;
+  }
 
   INIT_DBT(key, key_len);
 
-  TXN_BEGIN(db);
+  TXN_BEGIN(db, txn);
 
   rc = db->_db->del(db->_db, _txn, &dbt_key, flags);
 
@@ -632,6 +2010,80 @@ v8::Handle<v8::Value> Db::SetFlags(const v8::Arguments& args) {
   return msg;
 }
 
+v8::Handle<v8::Value> Db::SetGroupCommit(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  REQ_INT_ARG(0, maxOps);
+  REQ_INT_ARG(1, windowUsecs);
+
+  if (maxOps < 0 || windowUsecs < 0)
+    RET_EXC("group commit settings must be >= 0");
+
+  // Anything already queued goes out under the old settings.
+  db->flushGroup();
+  db->_groupMax = maxOps;
+  db->_groupWindow = windowUsecs;
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::SetKeyGate(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  REQ_INT_ARG(0, stripes);
+  REQ_INT_ARG(1, merge);
+
+  if (stripes <= 0)
+    RET_EXC("stripes must be > 0");
+  // Writes already in flight hold stripes of the current one
+  if (db->_gate != NULL)
+    RET_EXC("key gate already set");
+
+  db->_gate = new KeyGate(stripes, merge != 0);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::SetRetryPolicy(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  REQ_INT_ARG(0, retries);
+  REQ_INT_ARG(1, baseUsecs);
+  REQ_INT_ARG(2, maxUsecs);
+  REQ_INT_ARG(3, timeoutUsecs);
+  REQ_INT_ARG(4, defer);
+
+  if (retries < -1 || baseUsecs < 0 || maxUsecs < 0 || timeoutUsecs < 0)
+    RET_EXC("retry settings must be >= 0");
+
+  // -1 keeps what openSync() was given
+  if (retries >= 0)
+    db->_retry.retries = retries;
+  db->_retry.baseDelay = baseUsecs;
+  db->_retry.maxDelay = maxUsecs;
+  db->_retry.maxTime = timeoutUsecs;
+  db->_retry.defer = defer != 0;
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Db::RetryStats(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  DB_RES(0, db_strerror(0), msg);
+  msg->Set(retries_sym, v8::Number::New(db->_retry.retried));
+  msg->Set(give_ups_sym, v8::Number::New(db->_retry.gaveUp));
+  return msg;
+}
+
 v8::Handle<v8::Value> Db::Fd(const v8::Arguments& args) {
   v8::HandleScope scope;
 
@@ -646,6 +2098,266 @@ v8::Handle<v8::Value> Db::Fd(const v8::Arguments& args) {
   return msg;
 }
 
+v8::Handle<v8::Value> Db::Stat(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  OPT_TXN_ARG(0, txn);
+  REQ_INT_ARG(1, flags);
+  REQ_FN_ARG(2, cb);
+
+  EIOStatBaton *baton = new EIOStatBaton(db);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->setTxn(txn);
+  baton->flags = flags;
+
+  db->Ref();
+  WorkerPool::Submit(db->_queue, EIO_Stat, EIO_AfterStat, baton);
+
+  return v8::Undefined();
+}
+
+static v8::Local<v8::Object> HistogramObject(const Histogram &hist) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  obj->Set(count_sym, v8::Number::New(hist.count()));
+  obj->Set(mean_sym, v8::Number::New(hist.mean()));
+  obj->Set(p50_sym, v8::Number::New(hist.percentile(50)));
+  obj->Set(p99_sym, v8::Number::New(hist.percentile(99)));
+  obj->Set(p999_sym, v8::Number::New(hist.percentile(99.9)));
+  obj->Set(max_sym, v8::Number::New(hist.max()));
+  return obj;
+}
+
+v8::Handle<v8::Value> Db::LatencyStatsS(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  REQ_INT_ARG(0, reset);
+
+  static const char *ops[OP_COUNT] = { "get", "put", "del", "cursor" };
+  static const char *phases[PHASE_COUNT] = {
+    "queue", "exec", "complete", "retries"
+  };
+
+  Histogram (*hist)[PHASE_COUNT] = new Histogram[OP_COUNT][PHASE_COUNT];
+  db->_latency->snapshot(hist, reset != 0);
+
+  DB_RES(0, db_strerror(0), msg);
+  for (int op = 0; op < OP_COUNT; op++) {
+    v8::Local<v8::Object> phaseObj = v8::Object::New();
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+      phaseObj->Set(v8::String::NewSymbol(phases[phase]),
+                    HistogramObject(hist[op][phase]));
+    }
+    msg->Set(v8::String::NewSymbol(ops[op]), phaseObj);
+  }
+  delete [] hist;
+
+  return msg;
+}
+
+v8::Handle<v8::Value> Db::SetPageSize(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  REQ_INT_ARG(0, size);
+
+  int rc = db->_db->set_pagesize(db->_db, size);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> Db::SetBtMinKey(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  REQ_INT_ARG(0, minkey);
+
+  int rc = db->_db->set_bt_minkey(db->_db, minkey);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> Db::SetHFfactor(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  REQ_INT_ARG(0, ffactor);
+
+  int rc = db->_db->set_h_ffactor(db->_db, ffactor);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> Db::SetHNelem(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  REQ_INT_ARG(0, nelem);
+
+  int rc = db->_db->set_h_nelem(db->_db, nelem);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+// With no arguments, uses our word-at-a-time hash (see bdb_hash.h).
+// Otherwise (lib, sym) names a native hash to dlopen, with the signature
+// DB->set_h_hash() wants.
+v8::Handle<v8::Value> Db::SetHHash(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  u_int32_t (*hash)(DB *, const void *, u_int32_t) = WordHash;
+
+  if (args.Length() > 0) {
+    REQ_STR_ARG(0, lib);
+    REQ_STR_ARG(1, sym);
+
+    void *handle = dlopen(*lib, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+      DB_RES(-1, dlerror(), _msg);
+      return _msg;
+    }
+
+    hash = (u_int32_t (*)(DB *, const void *, u_int32_t)) dlsym(handle, *sym);
+    if (hash == NULL) {
+      DB_RES(-1, dlerror(), _msg);
+      return _msg;
+    }
+  }
+
+  int rc = db->_db->set_h_hash(db->_db, hash);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+// With no arguments, turns on BDB's own prefix compression.  Otherwise
+// (lib, compressSym, decompressSym) names a native codec to dlopen, with
+// the signatures DB->set_bt_compress() wants.
+v8::Handle<v8::Value> Db::SetBtCompress(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+
+  int (*compress)(DB *, const DBT *, const DBT *, const DBT *, const DBT *,
+                  DBT *) = NULL;
+  int (*decompress)(DB *, const DBT *, const DBT *, DBT *, DBT *,
+                    DBT *) = NULL;
+
+  if (args.Length() > 0) {
+    REQ_STR_ARG(0, lib);
+    REQ_STR_ARG(1, compressSym);
+    REQ_STR_ARG(2, decompressSym);
+
+    void *handle = dlopen(*lib, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+      DB_RES(-1, dlerror(), _msg);
+      return _msg;
+    }
+
+    compress = (int (*)(DB *, const DBT *, const DBT *, const DBT *,
+                        const DBT *, DBT *)) dlsym(handle, *compressSym);
+    if (compress == NULL) {
+      DB_RES(-1, dlerror(), _msg);
+      return _msg;
+    }
+    decompress = (int (*)(DB *, const DBT *, const DBT *, DBT *, DBT *,
+                          DBT *)) dlsym(handle, *decompressSym);
+    if (decompress == NULL) {
+      DB_RES(-1, dlerror(), _msg);
+      return _msg;
+    }
+
+    // Same as associate: the codec lives as long as the process does
+  }
+
+  int rc = db->_db->set_bt_compress(db->_db, compress, decompress);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+// (lib, prefix, dictionary|null, minSize): see bdb_codec.h for what the
+// library has to export.  Values shorter than minSize are stored as-is.
+v8::Handle<v8::Value> Db::SetCodec(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  Db* db = node::ObjectWrap::Unwrap<Db>(args.This());
+  REQ_STR_ARG(0, lib);
+  REQ_STR_ARG(1, prefix);
+  REQ_INT_ARG(3, minSize);
+
+  // Work already in flight would see the codec change under it
+  if (db->_codec != NULL)
+    RET_EXC("codec already set");
+  // See AssociateS
+  if (db->_associated)
+    RET_EXC("associate can't be used with a value codec");
+
+  const char *dict = NULL;
+  size_t dictlen = 0;
+  if (node::Buffer::HasInstance(args[2])) {
+    dict = node::Buffer::Data(args[2]->ToObject());
+    dictlen = node::Buffer::Length(args[2]->ToObject());
+  }
+
+  std::string error;
+  db->_codec = Codec::Load(*lib, *prefix, dict, dictlen,
+                           minSize > 0 ? minSize : 0, &error);
+  if (db->_codec == NULL) {
+    DB_RES(-1, error.c_str(), _msg);
+    return _msg;
+  }
+
+  DB_RES(0, db_strerror(0), msg);
+  return msg;
+}
+
+// (lib, prefix, samples, dictSize): trains a dictionary for small values
+// out of an Array of sample Buffers, and returns it as a Buffer.
+v8::Handle<v8::Value> Db::TrainCodec(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  REQ_STR_ARG(0, lib);
+  REQ_STR_ARG(1, prefix);
+  REQ_ARR_ARG(2, samples);
+  REQ_INT_ARG(3, dictSize);
+
+  if (dictSize <= 0)
+    RET_EXC("dictionary size must be > 0");
+
+  // The trainer wants the samples back to back
+  std::string packed;
+  std::vector<size_t> sizes(samples->Length());
+  for (uint32_t i = 0; i < samples->Length(); i++) {
+    v8::Local<v8::Value> sample = samples->Get(i);
+    if (!node::Buffer::HasInstance(sample))
+      RET_EXC("samples must be buffers");
+    sizes[i] = node::Buffer::Length(sample->ToObject());
+    packed.append(node::Buffer::Data(sample->ToObject()), sizes[i]);
+  }
+
+  node::Buffer *dict = node::Buffer::New(dictSize);
+  std::string error;
+  size_t len = Codec::Train(*lib, *prefix, packed.data(),
+                            sizes.empty() ? NULL : &sizes[0],
+                            sizes.size(), node::Buffer::Data(dict),
+                            dictSize, &error);
+  if (len == 0)
+    RET_EXC(error.c_str());
+
+  node::Buffer *out = node::Buffer::New(node::Buffer::Data(dict), len);
+  return scope.Close(out->handle_);
+}
+
 v8::Handle<v8::Value> Db::SetEncrypt(const v8::Arguments& args) {
   v8::HandleScope scope;
 
@@ -663,12 +2375,18 @@ v8::Handle<v8::Value> Db::New(const v8::Arguments& args) {
 
   REQ_OBJ_ARG(0, envObj);
   DbEnv *env = node::ObjectWrap::Unwrap<DbEnv>(envObj);
+  if (env->getDB_ENV() == NULL)
+    RET_EXC("environment is closed");
 
   Db* db = new Db();
   db->Wrap(args.This());
 
   db->_env = env->getDB_ENV();
   db->_transactional = env->isTransactional();
+  db->_concurrent = env->isConcurrent();
+  db->_queue = env->createQueue();
+  // Our queue (and the DB_ENV) belong to the env, so keep it around
+  db->_envHandle = v8::Persistent<v8::Object>::New(envObj);
 
   int rc = 0;
   if (db->_db == NULL)
@@ -687,21 +2405,49 @@ void Db::Initialize(v8::Handle<v8::Object> target) {
   t->InstanceTemplate()->SetInternalFieldCount(1);
 
   fd_sym = NODE_PSYMBOL("fd");
+  count_sym = NODE_PSYMBOL("count");
+  mean_sym = NODE_PSYMBOL("mean");
+  p50_sym = NODE_PSYMBOL("p50");
+  p99_sym = NODE_PSYMBOL("p99");
+  p999_sym = NODE_PSYMBOL("p999");
+  max_sym = NODE_PSYMBOL("max");
+  retries_sym = NODE_PSYMBOL("retries");
+  give_ups_sym = NODE_PSYMBOL("giveUps");
 
   NODE_SET_PROTOTYPE_METHOD(t, "_associateSync", AssociateS);
   NODE_SET_PROTOTYPE_METHOD(t, "_closeSync", CloseS);
   NODE_SET_PROTOTYPE_METHOD(t, "_cursorGet", CursorGet);
+  NODE_SET_PROTOTYPE_METHOD(t, "_cursorGetBulk", CursorGetBulk);
   NODE_SET_PROTOTYPE_METHOD(t, "_cursorGetSync", CursorGetS);
   NODE_SET_PROTOTYPE_METHOD(t, "_openSync", OpenS);
   NODE_SET_PROTOTYPE_METHOD(t, "_get", Get);
+  NODE_SET_PROTOTYPE_METHOD(t, "_getInto", GetInto);
+  NODE_SET_PROTOTYPE_METHOD(t, "_getRange", GetRange);
+  NODE_SET_PROTOTYPE_METHOD(t, "_getMany", GetMany);
   NODE_SET_PROTOTYPE_METHOD(t, "_getSync", GetS);
+  NODE_SET_PROTOTYPE_METHOD(t, "_latencyStats", LatencyStatsS);
   NODE_SET_PROTOTYPE_METHOD(t, "_put", Put);
   NODE_SET_PROTOTYPE_METHOD(t, "_putIf", PutIf);
+  NODE_SET_PROTOTYPE_METHOD(t, "_putMany", PutMany);
+  NODE_SET_PROTOTYPE_METHOD(t, "_putRange", PutRange);
   NODE_SET_PROTOTYPE_METHOD(t, "_putSync", PutS);
+  NODE_SET_PROTOTYPE_METHOD(t, "_retryStats", RetryStats);
   NODE_SET_PROTOTYPE_METHOD(t, "_del", Del);
   NODE_SET_PROTOTYPE_METHOD(t, "_delSync", DelS);
+  NODE_SET_PROTOTYPE_METHOD(t, "setBtCompress", SetBtCompress);
+  NODE_SET_PROTOTYPE_METHOD(t, "setBtMinKey", SetBtMinKey);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setCodec", SetCodec);
+  NODE_SET_PROTOTYPE_METHOD(t, "_trainCodec", TrainCodec);
   NODE_SET_PROTOTYPE_METHOD(t, "setEncrypt", SetEncrypt);
   NODE_SET_PROTOTYPE_METHOD(t, "setFlags", SetFlags);
+  NODE_SET_PROTOTYPE_METHOD(t, "setHFfactor", SetHFfactor);
+  NODE_SET_PROTOTYPE_METHOD(t, "setHHash", SetHHash);
+  NODE_SET_PROTOTYPE_METHOD(t, "setHNelem", SetHNelem);
+  NODE_SET_PROTOTYPE_METHOD(t, "setPageSize", SetPageSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setGroupCommit", SetGroupCommit);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setKeyGate", SetKeyGate);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setRetryPolicy", SetRetryPolicy);
+  NODE_SET_PROTOTYPE_METHOD(t, "_stat", Stat);
 
   target->Set(v8::String::NewSymbol("Db"), t->GetFunction());
 }
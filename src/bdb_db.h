@@ -2,7 +2,17 @@
 #ifndef BDB_DB_H_
 #define BDB_DB_H_
 
+#include <pthread.h>
+
+#include <deque>
+
 #include "bdb_object.h"
+#include "bdb_pool.h"
+
+class Codec;
+class EIODbBaton;
+class EIOGroupBaton;
+class KeyGate;
 
 class Db: public DbObject {
  public:
@@ -14,37 +24,119 @@ class Db: public DbObject {
   static v8::Handle<v8::Value> AssociateS(const v8::Arguments &);
   static v8::Handle<v8::Value> CloseS(const v8::Arguments &);
   static v8::Handle<v8::Value> CursorGet(const v8::Arguments &);
+  static v8::Handle<v8::Value> CursorGetBulk(const v8::Arguments &);
   static v8::Handle<v8::Value> CursorGetS(const v8::Arguments &);
   static v8::Handle<v8::Value> Del(const v8::Arguments &);
   static v8::Handle<v8::Value> DelS(const v8::Arguments &);
   static v8::Handle<v8::Value> Get(const v8::Arguments &);
+  static v8::Handle<v8::Value> GetInto(const v8::Arguments &);
+  static v8::Handle<v8::Value> GetMany(const v8::Arguments &);
+  static v8::Handle<v8::Value> GetRange(const v8::Arguments &);
   static v8::Handle<v8::Value> GetS(const v8::Arguments &);
+  static v8::Handle<v8::Value> LatencyStatsS(const v8::Arguments &);
   static v8::Handle<v8::Value> New(const v8::Arguments &);
   static v8::Handle<v8::Value> OpenS(const v8::Arguments &);
   static v8::Handle<v8::Value> Put(const v8::Arguments &);
   static v8::Handle<v8::Value> PutIf(const v8::Arguments &);
+  static v8::Handle<v8::Value> PutMany(const v8::Arguments &);
+  static v8::Handle<v8::Value> PutRange(const v8::Arguments &);
   static v8::Handle<v8::Value> PutS(const v8::Arguments &);
+  static v8::Handle<v8::Value> RetryStats(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetBtCompress(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetBtMinKey(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetCodec(const v8::Arguments &);
   static v8::Handle<v8::Value> SetEncrypt(const v8::Arguments &);
   static v8::Handle<v8::Value> SetFlags(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetGroupCommit(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetHFfactor(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetHHash(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetHNelem(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetKeyGate(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetPageSize(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetRetryPolicy(const v8::Arguments &);
+  static v8::Handle<v8::Value> Stat(const v8::Arguments &);
+  static v8::Handle<v8::Value> TrainCodec(const v8::Arguments &);
   static v8::Handle<v8::Value> Fd(const v8::Arguments &);
 
  protected:
   static int EIO_Get(eio_req *req);
   static int EIO_AfterGet(eio_req *req);
+  static int EIO_GetInto(eio_req *req);
+  static int EIO_AfterGetInto(eio_req *req);
+  static int EIO_GetMany(eio_req *req);
+  static int EIO_AfterGetMany(eio_req *req);
   static int EIO_CursorGet(eio_req *req);
   static int EIO_AfterCursorGet(eio_req *req);
+  static int EIO_CursorGetBulk(eio_req *req);
+  static int EIO_AfterCursorGetBulk(eio_req *req);
   static int EIO_Put(eio_req *req);
   static int EIO_PutIf(eio_req *req);
+  static int EIO_PutMany(eio_req *req);
+  static int EIO_AfterPutMany(eio_req *req);
+  static int EIO_PutGroup(eio_req *req);
+  static int EIO_GroupWritten(eio_req *req);
+  static int EIO_AfterPutGroup(eio_req *req);
   static int EIO_Del(eio_req *req);
+  static int EIO_AfterGated(eio_req *req);
+  static int EIO_Stat(eio_req *req);
+  static int EIO_AfterStat(eio_req *req);
+
+  static void GroupTimeout(EV_P_ ev_timer *w, int revents);
 
  private:
   Db(const Db &rhs);
   Db &operator=(const Db &rhs);
 
+  friend class Cursor;
+
+  void queueGroupPut(EIODbBaton *baton);
+  void flushGroup();
+  void writeGroup(EIOGroupBaton *baton);
+  void submitWrite(EIODbBaton *baton, WorkFn execute, bool mergeable);
+  bool holdWrite(EIOBaton *baton, WorkFn execute, WorkFn finish,
+                 bool gated, bool mergeable);
+  void cursorOpened();
+  void cursorClosed();
+  void refuseHeldWrites();
+  static int EIO_Refused(eio_req *req);
+
   DB *_db;
   DB_ENV *_env;
-  int _retries;
+  v8::Persistent<v8::Object> _envHandle;
+  RetryPolicy _retry;
   bool _transactional;
+  // CDB: no txns, one writer at a time; read-then-write ops go through a
+  // DB_WRITECURSOR so nobody writes in between
+  bool _concurrent;
+
+  // Group commit: auto-commit puts queued within a window share one txn
+  int _groupMax;
+  int _groupWindow;
+  EIOGroupBaton *_group;
+  ev_timer _groupTimer;
+  // Groups being written on a worker; close waits for these to finish
+  pthread_mutex_t _groupLock;
+  pthread_cond_t _groupIdle;
+  int _groupsRunning;
+
+  // Value compression (NULL for none); applied on the worker threads
+  Codec *_codec;
+  // Primary or secondary of an associate(); can't have a codec
+  bool _associated;
+
+  // Per-key admission for auto-commit writes (NULL for none)
+  KeyGate *_gate;
+
+  // CDB: open Cursors, and the async writes waiting for them to close
+  struct HeldWrite {
+    EIOBaton *baton;
+    WorkFn execute;
+    WorkFn finish;
+    bool gated;        // goes back through submitWrite()
+    bool mergeable;
+  };
+  int _cursors;
+  std::deque<HeldWrite> _held;
 };
 
 #endif  // BDB_DB_H_
@@ -1,13 +1,45 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "bdb_common.h"
 #include "bdb_env.h"
+#include "bdb_maint.h"
+#include "bdb_pool.h"
+#include "bdb_stats.h"
+#include "bdb_trickle.h"
 
 using v8::FunctionTemplate;
 
+v8::Persistent<v8::String> gbytes_sym;
+v8::Persistent<v8::String> bytes_sym;
+v8::Persistent<v8::String> ncache_sym;
+v8::Persistent<v8::String> runs_sym;
+v8::Persistent<v8::String> pages_written_sym;
+v8::Persistent<v8::String> throttled_sym;
+v8::Persistent<v8::String> clean_percent_sym;
+v8::Persistent<v8::String> errors_sym;
+v8::Persistent<v8::String> last_usec_sym;
+v8::Persistent<v8::String> max_usec_sym;
+v8::Persistent<v8::String> total_usec_sym;
+v8::Persistent<v8::String> checkpoint_sym;
+v8::Persistent<v8::String> archive_sym;
+v8::Persistent<v8::String> trickle_sym;
+v8::Persistent<v8::String> mpool_sym;
+v8::Persistent<v8::String> lock_sym;
+v8::Persistent<v8::String> log_sym;
+v8::Persistent<v8::String> txn_sym;
+v8::Persistent<v8::String> mutex_sym;
+
+// Which subsystems env.stats() was asked for
+#define STAT_MPOOL 0x01
+#define STAT_LOCK  0x02
+#define STAT_LOG   0x04
+#define STAT_TXN   0x08
+#define STAT_MUTEX 0x10
+
 class EIOCheckpointBaton: public EIOBaton {
  public:
   explicit EIOCheckpointBaton(DbEnv *env):
@@ -20,10 +52,66 @@ class EIOCheckpointBaton: public EIOBaton {
   EIOCheckpointBaton &operator=(const EIOCheckpointBaton &);
 };
 
+class EIOCacheBaton: public EIOBaton {
+ public:
+  explicit EIOCacheBaton(DbEnv *env):
+      EIOBaton(env), gbytes(0), bytes(0) {}
+  virtual ~EIOCacheBaton() {}
+  u_int32_t gbytes;
+  u_int32_t bytes;
+ private:
+  EIOCacheBaton(const EIOCacheBaton &);
+  EIOCacheBaton &operator=(const EIOCacheBaton &);
+};
+
+class EIOEnvStatBaton: public EIOBaton {
+ public:
+  explicit EIOEnvStatBaton(DbEnv *env):
+      EIOBaton(env), which(0), mpool(0), lock(0), log(0), txn(0), mutex(0) {}
+  virtual ~EIOEnvStatBaton() {
+    free(mpool);
+    free(lock);
+    free(log);
+    free(txn);
+    free(mutex);
+  }
+  int which;
+  DB_MPOOL_STAT *mpool;
+  DB_LOCK_STAT *lock;
+  DB_LOG_STAT *log;
+  DB_TXN_STAT *txn;
+  DB_MUTEX_STAT *mutex;
+ private:
+  EIOEnvStatBaton(const EIOEnvStatBaton &);
+  EIOEnvStatBaton &operator=(const EIOEnvStatBaton &);
+};
+
 
-DbEnv::DbEnv(): DbObject(), _transactional(false), _env(0) {}
+DbEnv::DbEnv():
+    DbObject(), _transactional(false), _concurrent(false), _env(0), _pool(0),
+    _trickler(0), _maintainer(0) {}
+
+// closeSync() frees the DB_ENV, so anything after it that would use the
+// handle gets EINVAL instead
+#define REQ_OPEN_ENV(ENV)                                 \
+  if ((ENV)->_env == NULL) {                              \
+    DB_RES(EINVAL, "environment is closed", _msg);        \
+    return _msg;                                          \
+  }
 
 DbEnv::~DbEnv() {
+  if (_maintainer != NULL) {
+    delete _maintainer;
+    _maintainer = NULL;
+  }
+  if (_trickler != NULL) {
+    delete _trickler;
+    _trickler = NULL;
+  }
+  if (_pool != NULL) {
+    delete _pool;
+    _pool = NULL;
+  }
   if (_env != NULL) {
     _env->close(_env, 0);
     _env = NULL;
@@ -38,6 +126,17 @@ bool DbEnv::isTransactional() {
   return _transactional;
 }
 
+bool DbEnv::isConcurrent() {
+  return _concurrent;
+}
+
+// A queue on our thread pool for a new Db, or NULL if we don't have one.
+WorkQueue *DbEnv::createQueue() {
+  if (_pool == NULL)
+    return NULL;
+  return _pool->createQueue();
+}
+
 // Start EIO Exposed Methonds
 
 int DbEnv::EIO_Checkpoint(eio_req *req) {
@@ -45,6 +144,7 @@ int DbEnv::EIO_Checkpoint(eio_req *req) {
 
   if (baton->object == NULL ||
       dynamic_cast<DbEnv *>(baton->object)->_env == NULL) {
+    baton->status = EINVAL;
     return 0;
   }
 
@@ -56,6 +156,93 @@ int DbEnv::EIO_Checkpoint(eio_req *req) {
   return 0;
 }
 
+// set_cachesize() on an open environment grows or shrinks the cache a
+// region at a time (bounded by set_cache_max), which can mean writing out
+// dirty pages, so it stays off the main thread.
+int DbEnv::EIO_ResizeCache(eio_req *req) {
+  EIOCacheBaton *baton = static_cast<EIOCacheBaton *>(req->data);
+
+  if (baton->object == NULL ||
+      dynamic_cast<DbEnv *>(baton->object)->_env == NULL) {
+    baton->status = EINVAL;
+    return 0;
+  }
+
+  DB_ENV *&env = dynamic_cast<DbEnv *>(baton->object)->_env;
+
+  // ncache is ignored once the environment is open
+  baton->status = env->set_cachesize(env, baton->gbytes, baton->bytes, 0);
+
+  return 0;
+}
+
+// These only read counters out of the shared regions (mpool also walks
+// its hash buckets for the clean/dirty counts), so they're cheap enough
+// to poll, but they do take region mutexes.
+int DbEnv::EIO_Stat(eio_req *req) {
+  EIOEnvStatBaton *baton = static_cast<EIOEnvStatBaton *>(req->data);
+
+  if (baton->object == NULL ||
+      dynamic_cast<DbEnv *>(baton->object)->_env == NULL) {
+    baton->status = EINVAL;
+    return 0;
+  }
+
+  DB_ENV *&env = dynamic_cast<DbEnv *>(baton->object)->_env;
+  u_int32_t flags = baton->flags;
+  int rc = 0;
+
+  if (rc == 0 && (baton->which & STAT_MPOOL))
+    rc = env->memp_stat(env, &(baton->mpool), NULL, flags);
+  if (rc == 0 && (baton->which & STAT_LOCK))
+    rc = env->lock_stat(env, &(baton->lock), flags);
+  if (rc == 0 && (baton->which & STAT_LOG))
+    rc = env->log_stat(env, &(baton->log), flags);
+  if (rc == 0 && (baton->which & STAT_TXN))
+    rc = env->txn_stat(env, &(baton->txn), flags);
+  if (rc == 0 && (baton->which & STAT_MUTEX))
+    rc = env->mutex_stat(env, &(baton->mutex), flags);
+
+  baton->status = rc;
+  return 0;
+}
+
+int DbEnv::EIO_AfterStat(eio_req *req) {
+  v8::HandleScope scope;
+  EIOEnvStatBaton *baton = static_cast<EIOEnvStatBaton *>(req->data);
+
+  v8::Handle<v8::Value> argv[2] = {};
+  argv[0] = StatusObject(baton->status);
+  if (baton->status == 0) {
+    v8::Local<v8::Object> stats = v8::Object::New();
+    if (baton->mpool != NULL)
+      stats->Set(mpool_sym, MpoolStatObject(baton->mpool));
+    if (baton->lock != NULL)
+      stats->Set(lock_sym, LockStatObject(baton->lock));
+    if (baton->log != NULL)
+      stats->Set(log_sym, LogStatObject(baton->log));
+    if (baton->txn != NULL)
+      stats->Set(txn_sym, TxnStatObject(baton->txn));
+    if (baton->mutex != NULL)
+      stats->Set(mutex_sym, MutexStatObject(baton->mutex));
+    argv[1] = stats;
+  } else {
+    argv[1] = v8::Undefined();
+  }
+
+  v8::TryCatch try_catch;
+
+  baton->cb->Call(v8::Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    node::FatalException(try_catch);
+
+  baton->object->Unref();
+  delete baton;
+
+  return 0;
+}
+
 // Start V8 Exposed Methods
 
 v8::Handle<v8::Value> DbEnv::New(const v8::Arguments& args) {
@@ -77,12 +264,79 @@ v8::Handle<v8::Value> DbEnv::CloseS(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, flags);
 
+  // Anything still queued runs before the environment goes away
+  if (env->_maintainer != NULL)
+    env->_maintainer->stop();
+  if (env->_trickler != NULL)
+    env->_trickler->stop();
+  if (env->_pool != NULL)
+    env->_pool->stop();
+
   int rc = env->_env->close(env->_env, flags);
+  env->_env = NULL;
+
+  // Both hold the DB_ENV, and are stopped already
+  if (env->_maintainer != NULL) {
+    delete env->_maintainer;
+    env->_maintainer = NULL;
+  }
+  if (env->_trickler != NULL) {
+    delete env->_trickler;
+    env->_trickler = NULL;
+  }
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::GetCacheSize(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  u_int32_t gbytes = 0;
+  u_int32_t bytes = 0;
+  int ncache = 0;
+  int rc = env->_env->get_cachesize(env->_env, &gbytes, &bytes, &ncache);
 
   DB_RES(rc, db_strerror(rc), msg);
+  if (rc == 0) {
+    msg->Set(gbytes_sym, v8::Integer::NewFromUnsigned(gbytes));
+    msg->Set(bytes_sym, v8::Integer::NewFromUnsigned(bytes));
+    msg->Set(ncache_sym, v8::Integer::New(ncache));
+  }
+  return msg;
+}
+
+static v8::Local<v8::Object> StepObject(const StepCounters &step) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  obj->Set(runs_sym, v8::Number::New(step.runs));
+  obj->Set(errors_sym, v8::Number::New(step.errors));
+  obj->Set(last_usec_sym, v8::Number::New(step.lastUsec));
+  obj->Set(max_usec_sym, v8::Number::New(step.maxUsec));
+  obj->Set(total_usec_sym, v8::Number::New(step.totalUsec));
+  return obj;
+}
+
+v8::Handle<v8::Value> DbEnv::MaintenanceStats(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  MaintenanceCounters stats;
+  memset(&stats, 0, sizeof(stats));
+  if (env->_maintainer != NULL)
+    env->_maintainer->stats(&stats);
+
+  DB_RES(0, db_strerror(0), msg);
+  msg->Set(checkpoint_sym, StepObject(stats.checkpoint));
+  msg->Set(archive_sym, StepObject(stats.archive));
+  msg->Set(trickle_sym, StepObject(stats.trickle));
   return msg;
 }
 
@@ -90,13 +344,68 @@ v8::Handle<v8::Value> DbEnv::OpenS(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
-  REQ_STR_ARG(0, db_home);
+  // No home is fine for a DB_PRIVATE env that never touches disk
+  OPT_STR_ARG(0, db_home);
   REQ_INT_ARG(1, flags);
   REQ_INT_ARG(2, mode);
 
   env->_transactional = (flags & DB_INIT_TXN);
-  int rc = env->_env->open(env->_env, *db_home, flags, mode);
+  env->_concurrent = (flags & DB_INIT_CDB);
+  int rc = env->_env->open(env->_env, db_home, flags, mode);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::ResizeCache(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  REQ_INT_ARG(0, gbytes);
+  REQ_INT_ARG(1, bytes);
+  REQ_FN_ARG(2, cb);
+
+  EIOCacheBaton *baton = new EIOCacheBaton(env);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->gbytes = gbytes;
+  baton->bytes = bytes;
+
+  env->Ref();
+  WorkerPool::Submit(env->_queue, EIO_ResizeCache, EIO_After_ReturnStatus,
+                     baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> DbEnv::SetCacheMax(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  REQ_INT_ARG(0, gbytes);
+  REQ_INT_ARG(1, bytes);
+
+  int rc = env->_env->set_cache_max(env->_env, gbytes, bytes);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::SetCacheSize(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  REQ_INT_ARG(0, gbytes);
+  REQ_INT_ARG(1, bytes);
+  REQ_INT_ARG(2, ncache);
+
+  int rc = env->_env->set_cachesize(env->_env, gbytes, bytes, ncache);
 
   DB_RES(rc, db_strerror(rc), msg);
   return msg;
@@ -106,6 +415,7 @@ v8::Handle<v8::Value> DbEnv::SetEncrypt(const v8::Arguments& args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
   REQ_STR_ARG(0, passwd);
 
   int rc = env->_env->set_encrypt(env->_env, *passwd, DB_ENCRYPT_AES);
@@ -118,6 +428,7 @@ v8::Handle<v8::Value> DbEnv::SetErrorFile(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
   REQ_STR_ARG(0, fname);
 
   FILE *fp = fopen(*fname, "a");
@@ -136,6 +447,7 @@ v8::Handle<v8::Value> DbEnv::SetErrorPrefix(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
   REQ_STR_ARG(0, prefix);
 
   // Yes, this is a memory leak, but BDB is just really stupid about this...
@@ -149,6 +461,7 @@ v8::Handle<v8::Value> DbEnv::SetFlags(const v8::Arguments& args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
   REQ_INT_ARG(0, flags);
   REQ_INT_ARG(1, onoff);
 
@@ -163,6 +476,7 @@ v8::Handle<v8::Value> DbEnv::SetLockDetect(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, policy);
 
@@ -176,6 +490,7 @@ v8::Handle<v8::Value> DbEnv::SetLockTimeout(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, timeout);
 
@@ -185,10 +500,36 @@ v8::Handle<v8::Value> DbEnv::SetLockTimeout(const v8::Arguments &args) {
   return msg;
 }
 
+v8::Handle<v8::Value> DbEnv::SetLogBufferSize(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+  REQ_INT_ARG(0, size);
+
+  int rc = env->_env->set_lg_bsize(env->_env, size);
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::SetLogConfig(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+  REQ_INT_ARG(0, flags);
+  REQ_INT_ARG(1, onoff);
+
+  int rc = env->_env->log_set_config(env->_env, flags, onoff);
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
 v8::Handle<v8::Value> DbEnv::SetMaxLocks(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, max);
 
@@ -202,6 +543,7 @@ v8::Handle<v8::Value> DbEnv::SetMaxLockers(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, max);
 
@@ -215,6 +557,7 @@ v8::Handle<v8::Value> DbEnv::SetMaxLockObjects(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, max);
 
@@ -224,10 +567,28 @@ v8::Handle<v8::Value> DbEnv::SetMaxLockObjects(const v8::Arguments &args) {
   return msg;
 }
 
+v8::Handle<v8::Value> DbEnv::SetMmapSize(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  REQ_INT_ARG(0, gbytes);
+  REQ_INT_ARG(1, bytes);
+
+  size_t size = static_cast<size_t>(gbytes) * 1024 * 1024 * 1024 +
+      static_cast<u_int32_t>(bytes);
+  int rc = env->_env->set_mp_mmapsize(env->_env, size);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
 v8::Handle<v8::Value> DbEnv::SetShmKey(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
   REQ_INT_ARG(0, shmKey);
 
   int rc = env->_env->set_shm_key(env->_env, shmKey);
@@ -239,6 +600,7 @@ v8::Handle<v8::Value> DbEnv::SetTxnMax(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, max);
 
@@ -252,6 +614,7 @@ v8::Handle<v8::Value> DbEnv::SetTxnTimeout(const v8::Arguments &args) {
   v8::HandleScope scope;
 
   DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
 
   REQ_INT_ARG(0, timeout);
 
@@ -261,6 +624,134 @@ v8::Handle<v8::Value> DbEnv::SetTxnTimeout(const v8::Arguments &args) {
   return msg;
 }
 
+v8::Handle<v8::Value> DbEnv::SetThreadPool(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  REQ_INT_ARG(0, threads);
+  REQ_INT_ARG(1, priority);
+
+  if (env->_pool == NULL) {
+    env->_pool = new WorkerPool();
+    env->_queue = env->_pool->createQueue();
+  }
+  int rc = env->_pool->start(threads, priority);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::StartMaintenance(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  REQ_INT_ARG(0, interval);
+  REQ_INT_ARG(1, checkpoint);
+  REQ_INT_ARG(2, kbytes);
+  REQ_INT_ARG(3, minutes);
+  REQ_INT_ARG(4, trickle);
+  REQ_INT_ARG(5, archive);
+  REQ_STR_ARG(6, archiveDir);
+
+  MaintenanceConfig config;
+  config.interval = interval;
+  config.checkpoint = checkpoint != 0;
+  config.kbytes = kbytes;
+  config.minutes = minutes;
+  config.trickle = trickle;
+  config.archive = archive != 0;
+  config.archiveDir = *archiveDir;
+
+  if (env->_maintainer == NULL)
+    env->_maintainer = new Maintainer(env->_env);
+  int rc = env->_maintainer->start(config);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::Stat(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  REQ_INT_ARG(0, which);
+  REQ_INT_ARG(1, flags);
+  REQ_FN_ARG(2, cb);
+
+  EIOEnvStatBaton *baton = new EIOEnvStatBaton(env);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->which = which;
+  baton->flags = flags;
+
+  env->Ref();
+  WorkerPool::Submit(env->_queue, EIO_Stat, EIO_AfterStat, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> DbEnv::StartTrickle(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+  REQ_OPEN_ENV(env);
+
+  REQ_INT_ARG(0, percent);
+  REQ_INT_ARG(1, rate);
+  REQ_INT_ARG(2, interval);
+
+  if (env->_trickler == NULL)
+    env->_trickler = new Trickler(env->_env);
+  int rc = env->_trickler->start(percent, rate, interval);
+
+  DB_RES(rc, db_strerror(rc), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::StopMaintenance(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  if (env->_maintainer != NULL)
+    env->_maintainer->stop();
+
+  DB_RES(0, db_strerror(0), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::StopTrickle(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  if (env->_trickler != NULL)
+    env->_trickler->stop();
+
+  DB_RES(0, db_strerror(0), msg);
+  return msg;
+}
+
+v8::Handle<v8::Value> DbEnv::TrickleStats(const v8::Arguments& args) {
+  v8::HandleScope scope;
+
+  DbEnv* env = node::ObjectWrap::Unwrap<DbEnv>(args.This());
+
+  TrickleCounters stats;
+  memset(&stats, 0, sizeof(stats));
+  if (env->_trickler != NULL)
+    env->_trickler->stats(&stats);
+
+  DB_RES(0, db_strerror(0), msg);
+  msg->Set(runs_sym, v8::Number::New(stats.runs));
+  msg->Set(pages_written_sym, v8::Number::New(stats.pagesWritten));
+  msg->Set(throttled_sym, v8::Number::New(stats.throttled));
+  msg->Set(clean_percent_sym, v8::Integer::New(stats.cleanPercent));
+  return msg;
+}
 
 v8::Handle<v8::Value> DbEnv::TxnCheckpoint(const v8::Arguments& args) {
   v8::HandleScope scope;
@@ -279,8 +770,8 @@ v8::Handle<v8::Value> DbEnv::TxnCheckpoint(const v8::Arguments& args) {
   baton->minutes = minutes;
 
   env->Ref();
-  eio_custom(EIO_Checkpoint, EIO_PRI_DEFAULT, EIO_After_ReturnStatus, baton);
-  ev_ref(EV_DEFAULT_UC);
+  WorkerPool::Submit(env->_queue, EIO_Checkpoint, EIO_After_ReturnStatus,
+                     baton);
 
   return v8::Undefined();
 }
@@ -292,20 +783,55 @@ void DbEnv::Initialize(v8::Handle<v8::Object> target) {
   v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(New);
   t->InstanceTemplate()->SetInternalFieldCount(1);
 
+  gbytes_sym = NODE_PSYMBOL("gbytes");
+  bytes_sym = NODE_PSYMBOL("bytes");
+  ncache_sym = NODE_PSYMBOL("ncache");
+  runs_sym = NODE_PSYMBOL("runs");
+  pages_written_sym = NODE_PSYMBOL("pagesWritten");
+  throttled_sym = NODE_PSYMBOL("throttled");
+  clean_percent_sym = NODE_PSYMBOL("cleanPercent");
+  errors_sym = NODE_PSYMBOL("errors");
+  last_usec_sym = NODE_PSYMBOL("lastUsec");
+  max_usec_sym = NODE_PSYMBOL("maxUsec");
+  total_usec_sym = NODE_PSYMBOL("totalUsec");
+  checkpoint_sym = NODE_PSYMBOL("checkpoint");
+  archive_sym = NODE_PSYMBOL("archive");
+  trickle_sym = NODE_PSYMBOL("trickle");
+  mpool_sym = NODE_PSYMBOL("mpool");
+  lock_sym = NODE_PSYMBOL("lock");
+  log_sym = NODE_PSYMBOL("log");
+  txn_sym = NODE_PSYMBOL("txn");
+  mutex_sym = NODE_PSYMBOL("mutex");
+
   NODE_SET_PROTOTYPE_METHOD(t, "_closeSync", CloseS);
+  NODE_SET_PROTOTYPE_METHOD(t, "_getCacheSize", GetCacheSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "maintenanceStats", MaintenanceStats);
   NODE_SET_PROTOTYPE_METHOD(t, "_openSync", OpenS);
+  NODE_SET_PROTOTYPE_METHOD(t, "_resizeCache", ResizeCache);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setCacheMax", SetCacheMax);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setCacheSize", SetCacheSize);
   NODE_SET_PROTOTYPE_METHOD(t, "setEncrypt", SetEncrypt);
   NODE_SET_PROTOTYPE_METHOD(t, "setErrorFile", SetErrorFile);
   NODE_SET_PROTOTYPE_METHOD(t, "setErrorPrefix", SetErrorPrefix);
   NODE_SET_PROTOTYPE_METHOD(t, "setFlags", SetFlags);
   NODE_SET_PROTOTYPE_METHOD(t, "setLockDetect", SetLockDetect);
   NODE_SET_PROTOTYPE_METHOD(t, "setLockTimeout", SetLockTimeout);
+  NODE_SET_PROTOTYPE_METHOD(t, "setLogBufferSize", SetLogBufferSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setLogConfig", SetLogConfig);
   NODE_SET_PROTOTYPE_METHOD(t, "setMaxLocks", SetMaxLocks);
   NODE_SET_PROTOTYPE_METHOD(t, "setMaxLockers", SetMaxLockers);
   NODE_SET_PROTOTYPE_METHOD(t, "setMaxLockObjects", SetMaxLockObjects);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setMmapSize", SetMmapSize);
   NODE_SET_PROTOTYPE_METHOD(t, "setShmKey", SetShmKey);
+  NODE_SET_PROTOTYPE_METHOD(t, "_setThreadPool", SetThreadPool);
   NODE_SET_PROTOTYPE_METHOD(t, "setTxnMax", SetTxnMax);
   NODE_SET_PROTOTYPE_METHOD(t, "setTxnTimeout", SetTxnTimeout);
+  NODE_SET_PROTOTYPE_METHOD(t, "_startMaintenance", StartMaintenance);
+  NODE_SET_PROTOTYPE_METHOD(t, "_startTrickle", StartTrickle);
+  NODE_SET_PROTOTYPE_METHOD(t, "_stat", Stat);
+  NODE_SET_PROTOTYPE_METHOD(t, "stopMaintenance", StopMaintenance);
+  NODE_SET_PROTOTYPE_METHOD(t, "stopTrickle", StopTrickle);
+  NODE_SET_PROTOTYPE_METHOD(t, "trickleStats", TrickleStats);
   NODE_SET_PROTOTYPE_METHOD(t, "_txnCheckpoint", TxnCheckpoint);
 
   target->Set(v8::String::NewSymbol("DbEnv"), t->GetFunction());
@@ -6,6 +6,10 @@
 
 #include "bdb_object.h"
 
+class Maintainer;
+class Trickler;
+class WorkerPool;
+
 
 class DbEnv: public DbObject {
  public:
@@ -17,32 +21,56 @@ class DbEnv: public DbObject {
   static void Initialize(v8::Handle<v8::Object> target);
 
   static v8::Handle<v8::Value> CloseS(const v8::Arguments &);
+  static v8::Handle<v8::Value> GetCacheSize(const v8::Arguments &);
+  static v8::Handle<v8::Value> MaintenanceStats(const v8::Arguments &);
   static v8::Handle<v8::Value> New(const v8::Arguments &);
   static v8::Handle<v8::Value> OpenS(const v8::Arguments &);
+  static v8::Handle<v8::Value> ResizeCache(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetCacheMax(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetCacheSize(const v8::Arguments &);
   static v8::Handle<v8::Value> SetEncrypt(const v8::Arguments &);
   static v8::Handle<v8::Value> SetErrorFile(const v8::Arguments &);
   static v8::Handle<v8::Value> SetErrorPrefix(const v8::Arguments &);
   static v8::Handle<v8::Value> SetFlags(const v8::Arguments &);
   static v8::Handle<v8::Value> SetLockDetect(const v8::Arguments &);
   static v8::Handle<v8::Value> SetLockTimeout(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetLogBufferSize(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetLogConfig(const v8::Arguments &);
   static v8::Handle<v8::Value> SetMaxLocks(const v8::Arguments &);
   static v8::Handle<v8::Value> SetMaxLockers(const v8::Arguments &);
   static v8::Handle<v8::Value> SetMaxLockObjects(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetMmapSize(const v8::Arguments &);
   static v8::Handle<v8::Value> SetShmKey(const v8::Arguments &);
+  static v8::Handle<v8::Value> SetThreadPool(const v8::Arguments &);
   static v8::Handle<v8::Value> SetTxnMax(const v8::Arguments &);
   static v8::Handle<v8::Value> SetTxnTimeout(const v8::Arguments &);
+  static v8::Handle<v8::Value> StartMaintenance(const v8::Arguments &);
+  static v8::Handle<v8::Value> Stat(const v8::Arguments &);
+  static v8::Handle<v8::Value> StartTrickle(const v8::Arguments &);
+  static v8::Handle<v8::Value> StopMaintenance(const v8::Arguments &);
+  static v8::Handle<v8::Value> StopTrickle(const v8::Arguments &);
+  static v8::Handle<v8::Value> TrickleStats(const v8::Arguments &);
   static v8::Handle<v8::Value> TxnCheckpoint(const v8::Arguments &);
 
   bool isTransactional();
+  bool isConcurrent();
+  WorkQueue *createQueue();
 
  private:
   DbEnv(const DbEnv &);
   DbEnv &operator=(const DbEnv &);
 
   static int EIO_Checkpoint(eio_req *req);
+  static int EIO_ResizeCache(eio_req *req);
+  static int EIO_Stat(eio_req *req);
+  static int EIO_AfterStat(eio_req *req);
 
   bool _transactional;
+  bool _concurrent;     // Concurrent Data Store (DB_INIT_CDB)
   DB_ENV *_env;
+  WorkerPool *_pool;
+  Trickler *_trickler;
+  Maintainer *_maintainer;
 };
 
 #endif  // BDB_ENV_H_
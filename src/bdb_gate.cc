@@ -0,0 +1,72 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <string.h>
+
+#include "bdb_gate.h"
+
+static bool SameKey(const DBT *a, const DBT *b) {
+  return a->size == b->size && memcmp(a->data, b->data, a->size) == 0;
+}
+
+KeyGate::KeyGate(int stripes, bool merge):
+    _stripes(stripes > 0 ? stripes : 1), _merge(merge) {}
+
+KeyGate::~KeyGate() {
+  for (size_t i = 0; i < _stripes.size(); i++) {
+    delete _stripes[i].running;
+    for (size_t j = 0; j < _stripes[i].waiting.size(); j++)
+      delete _stripes[i].waiting[j];
+  }
+}
+
+// FNV-1a
+int KeyGate::stripe(const DBT *key) const {
+  const unsigned char *p = static_cast<const unsigned char *>(key->data);
+  u_int32_t hash = 2166136261U;
+  for (u_int32_t i = 0; i < key->size; i++) {
+    hash ^= p[i];
+    hash *= 16777619U;
+  }
+  return hash % _stripes.size();
+}
+
+bool KeyGate::enter(int stripe, GatedOp *op) {
+  Stripe &s = _stripes[stripe];
+  if (s.running == NULL) {
+    s.running = op;
+    return true;
+  }
+
+  // Only the newest waiting op on this key can be replaced; anything
+  // else on the key in between (a del, a putIf) has to see it first.
+  if (_merge && op->mergeable) {
+    for (size_t i = s.waiting.size(); i-- > 0;) {
+      GatedOp *older = s.waiting[i];
+      if (!SameKey(older->key, op->key))
+        continue;
+      if (older->mergeable) {
+        op->merged.swap(older->merged);
+        op->merged.push_back(older->baton);
+        s.waiting[i] = op;
+        delete older;
+        return false;
+      }
+      break;
+    }
+  }
+
+  s.waiting.push_back(op);
+  return false;
+}
+
+GatedOp *KeyGate::leave(int stripe, GatedOp **next) {
+  Stripe &s = _stripes[stripe];
+  GatedOp *done = s.running;
+  s.running = NULL;
+  *next = NULL;
+  if (!s.waiting.empty()) {
+    s.running = s.waiting.front();
+    s.waiting.pop_front();
+    *next = s.running;
+  }
+  return done;
+}
@@ -0,0 +1,70 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_GATE_H_
+#define BDB_GATE_H_
+
+#include <db.h>
+
+#include <deque>
+#include <vector>
+
+#include "bdb_pool.h"
+
+class EIOBaton;
+
+// An auto-commit write waiting for (or holding) its stripe
+struct GatedOp {
+  GatedOp(EIOBaton *b, WorkFn e, WorkFn f, const DBT *k, bool m):
+      baton(b), execute(e), finish(f), key(k), mergeable(m), merged() {}
+
+  EIOBaton *baton;
+  WorkFn execute;
+  WorkFn finish;
+  const DBT *key;
+  bool mergeable;             // a plain put: a later one to the key wins
+  std::vector<EIOBaton *> merged;   // older puts this one replaced
+};
+
+
+// Admission control for writes, in front of the worker pool.  Keys hash
+// to one of N stripes, and only one write per stripe is handed to BDB at
+// a time; the rest wait here, in order.  Writes to the same hot key then
+// queue behind each other instead of deadlocking inside BDB, while
+// writes to different stripes still run in parallel.
+//
+// Everything happens on the main thread (at submit and completion), so
+// there's nothing to lock.
+//
+// With merging on, a plain put that finds an older plain put to the same
+// key still waiting takes its place, and the older one is answered with
+// the newer one's status (last writer wins; it would have been
+// overwritten anyway).
+class KeyGate {
+ public:
+  KeyGate(int stripes, bool merge);
+  ~KeyGate();
+
+  int stripe(const DBT *key) const;
+
+  // Takes op.  True if the caller should submit it now (it holds the
+  // stripe until leave()); false if it was queued or merged.
+  bool enter(int stripe, GatedOp *op);
+
+  // The stripe's running op finished: returns it (the caller deletes
+  // it), and sets *next to the op to submit now, if any.
+  GatedOp *leave(int stripe, GatedOp **next);
+
+ private:
+  KeyGate(const KeyGate &);
+  KeyGate &operator=(const KeyGate &);
+
+  struct Stripe {
+    Stripe(): running(0), waiting() {}
+    GatedOp *running;
+    std::deque<GatedOp *> waiting;
+  };
+
+  std::vector<Stripe> _stripes;
+  bool _merge;
+};
+
+#endif  // BDB_GATE_H_
@@ -0,0 +1,103 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <string.h>
+
+#include "bdb_hash.h"
+
+static const u_int64_t SECRET0 = 0xa0761d6478bd642fULL;
+static const u_int64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+static const u_int64_t SECRET2 = 0x8ebc6af09c88c6e3ULL;
+static const u_int64_t SECRET3 = 0x589965cc75374cc3ULL;
+
+static inline u_int64_t Read8(const unsigned char *p) {
+  u_int64_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline u_int64_t Read4(const unsigned char *p) {
+  u_int32_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+// 1-3 bytes: first, middle and last
+static inline u_int64_t Read3(const unsigned char *p, u_int32_t k) {
+  return (static_cast<u_int64_t>(p[0]) << 16) |
+      (static_cast<u_int64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+// a * b, as a 128-bit (lo, hi) pair
+static inline void Multiply(u_int64_t *a, u_int64_t *b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = static_cast<__uint128_t>(*a) * *b;
+  *a = static_cast<u_int64_t>(r);
+  *b = static_cast<u_int64_t>(r >> 64);
+#else
+  u_int64_t ha = *a >> 32, hb = *b >> 32;
+  u_int64_t la = static_cast<u_int32_t>(*a), lb = static_cast<u_int32_t>(*b);
+  u_int64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  u_int64_t t = rl + (rm0 << 32);
+  u_int64_t c = t < rl;
+  u_int64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline u_int64_t Mix(u_int64_t a, u_int64_t b) {
+  Multiply(&a, &b);
+  return a ^ b;
+}
+
+u_int32_t WordHash(DB *db, const void *bytes, u_int32_t length) {
+  const unsigned char *p = static_cast<const unsigned char *>(bytes);
+  u_int64_t seed = SECRET0 ^ Mix(SECRET0, SECRET1);
+  u_int64_t a, b;
+
+  if (length <= 16) {
+    if (length >= 4) {
+      u_int32_t mid = (length >> 3) << 2;
+      a = (Read4(p) << 32) | Read4(p + mid);
+      b = (Read4(p + length - 4) << 32) | Read4(p + length - 4 - mid);
+    } else if (length > 0) {
+      a = Read3(p, length);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    u_int32_t left = length;
+    if (left > 48) {
+      u_int64_t lane1 = seed, lane2 = seed;
+      do {
+        seed = Mix(Read8(p) ^ SECRET1, Read8(p + 8) ^ seed);
+        lane1 = Mix(Read8(p + 16) ^ SECRET2, Read8(p + 24) ^ lane1);
+        lane2 = Mix(Read8(p + 32) ^ SECRET3, Read8(p + 40) ^ lane2);
+        p += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= lane1 ^ lane2;
+    }
+    while (left > 16) {
+      seed = Mix(Read8(p) ^ SECRET1, Read8(p + 8) ^ seed);
+      p += 16;
+      left -= 16;
+    }
+    // The last 16 bytes, overlapping what's already been mixed
+    a = Read8(p + left - 16);
+    b = Read8(p + left - 8);
+  }
+
+  a ^= SECRET1;
+  b ^= seed;
+  Multiply(&a, &b);
+  u_int64_t h = Mix(a ^ SECRET0 ^ length, b ^ SECRET1);
+  return static_cast<u_int32_t>(h ^ (h >> 32));
+}
@@ -0,0 +1,17 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_HASH_H_
+#define BDB_HASH_H_
+
+#include <db.h>
+
+// A word-at-a-time hash for DB_HASH databases, in the style of wyhash: 8
+// bytes per step, three independent lanes for long keys, folded with a
+// 64x64->128 multiply.  BDB's own (__ham_func5, FNV-1a) goes a byte at a
+// time.  Keys are read little-endian, so the values (which end up in the
+// file's bucket layout) are the same on any host.
+//
+// A database has to be opened with the hash it was created with.  BDB
+// only checks that in db_verify; otherwise its keys just aren't found.
+u_int32_t WordHash(DB *db, const void *bytes, u_int32_t length);
+
+#endif  // BDB_HASH_H_
@@ -0,0 +1,167 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <string.h>
+#include <time.h>
+
+#include "bdb_latency.h"
+
+// Which shard this thread records into; handed out round robin
+static __thread int shard_index = -1;
+static int next_shard = 0;
+
+// Start OpTiming
+
+void OpTiming::submit(LatencyOp o) {
+  op = o;
+  submitted = LatencyStats::Now();
+}
+
+// Start Histogram
+
+Histogram::Histogram(): _sum(0) {
+  memset(_counts, 0, sizeof(_counts));
+}
+
+int Histogram::Bucket(u_int64_t value) {
+  if (value < SUB_BUCKETS)
+    return static_cast<int>(value);
+
+  int exp = 63 - __builtin_clzll(value);
+  if (exp > MAX_EXP)
+    return BUCKETS - 1;
+  int sub = static_cast<int>(value >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1);
+  return SUB_BUCKETS * (exp - SUB_BITS + 1) + sub;
+}
+
+// The largest value that lands in a bucket, which is what percentiles
+// report (so they err high, never low)
+u_int64_t Histogram::BucketTop(int bucket) {
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+
+  int exp = bucket / SUB_BUCKETS + SUB_BITS - 1;
+  u_int64_t sub = bucket % SUB_BUCKETS;
+  u_int64_t base = (static_cast<u_int64_t>(SUB_BUCKETS) + sub) <<
+      (exp - SUB_BITS);
+  return base + (1ULL << (exp - SUB_BITS)) - 1;
+}
+
+void Histogram::record(u_int64_t value) {
+  __sync_fetch_and_add(&(_counts[Bucket(value)]), 1);
+  __sync_fetch_and_add(&_sum, value);
+}
+
+void Histogram::drain(Histogram *into, bool reset) {
+  for (int i = 0; i < BUCKETS; i++) {
+    if (reset) {
+      into->_counts[i] += __sync_fetch_and_and(&(_counts[i]), 0);
+    } else {
+      into->_counts[i] += _counts[i];
+    }
+  }
+  if (reset) {
+    into->_sum += __sync_fetch_and_and(&_sum, 0);
+  } else {
+    into->_sum += _sum;
+  }
+}
+
+u_int64_t Histogram::count() const {
+  u_int64_t n = 0;
+  for (int i = 0; i < BUCKETS; i++)
+    n += _counts[i];
+  return n;
+}
+
+u_int64_t Histogram::percentile(double p) const {
+  u_int64_t total = count();
+  if (total == 0)
+    return 0;
+
+  u_int64_t rank = static_cast<u_int64_t>(p / 100.0 * total + 0.5);
+  if (rank < 1)
+    rank = 1;
+  u_int64_t seen = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += _counts[i];
+    if (seen >= rank)
+      return BucketTop(i);
+  }
+  return max();
+}
+
+u_int64_t Histogram::max() const {
+  for (int i = BUCKETS - 1; i >= 0; i--) {
+    if (_counts[i] > 0)
+      return BucketTop(i);
+  }
+  return 0;
+}
+
+double Histogram::mean() const {
+  u_int64_t total = count();
+  return total == 0 ? 0 : static_cast<double>(_sum) / total;
+}
+
+// Start LatencyStats
+
+LatencyStats::LatencyStats() {
+  memset(_shards, 0, sizeof(_shards));
+}
+
+LatencyStats::~LatencyStats() {
+  for (int i = 0; i < SHARDS; i++)
+    delete _shards[i];
+}
+
+u_int64_t LatencyStats::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<u_int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+LatencyStats::Shard *LatencyStats::shard() {
+  if (shard_index < 0)
+    shard_index = __sync_fetch_and_add(&next_shard, 1) % SHARDS;
+
+  Shard *s = _shards[shard_index];
+  if (s == NULL) {
+    Shard *fresh = new Shard();
+    if (__sync_bool_compare_and_swap(&(_shards[shard_index]), NULL, fresh)) {
+      s = fresh;
+    } else {
+      delete fresh;
+      s = _shards[shard_index];
+    }
+  }
+  return s;
+}
+
+void LatencyStats::recordWork(const OpTiming &timing) {
+  if (timing.op < 0 || timing.op >= OP_COUNT || timing.started == 0)
+    return;
+
+  Histogram *hist = shard()->hist[timing.op];
+  hist[PHASE_QUEUE].record(timing.started - timing.submitted);
+  hist[PHASE_EXEC].record(timing.finished - timing.started);
+  hist[PHASE_RETRIES].record(timing.retries);
+}
+
+void LatencyStats::recordComplete(const OpTiming &timing) {
+  if (timing.op < 0 || timing.op >= OP_COUNT || timing.finished == 0)
+    return;
+
+  shard()->hist[timing.op][PHASE_COMPLETE].record(Now() - timing.finished);
+}
+
+void LatencyStats::snapshot(Histogram out[OP_COUNT][PHASE_COUNT],
+                            bool reset) {
+  for (int i = 0; i < SHARDS; i++) {
+    Shard *s = _shards[i];
+    if (s == NULL)
+      continue;
+    for (int op = 0; op < OP_COUNT; op++) {
+      for (int phase = 0; phase < PHASE_COUNT; phase++)
+        s->hist[op][phase].drain(&(out[op][phase]), reset);
+    }
+  }
+}
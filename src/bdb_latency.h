@@ -0,0 +1,107 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_LATENCY_H_
+#define BDB_LATENCY_H_
+
+#include <db.h>
+
+// Operations we keep latencies for
+enum LatencyOp {
+  OP_NONE = -1,
+  OP_GET = 0,
+  OP_PUT,
+  OP_DEL,
+  OP_CURSOR,
+  OP_COUNT
+};
+
+// Where an operation's time went
+enum LatencyPhase {
+  PHASE_QUEUE = 0,    // submitted -> a worker picked it up
+  PHASE_EXEC,         // inside BDB on the worker (retries included)
+  PHASE_COMPLETE,     // worker done -> callback about to run
+  PHASE_RETRIES,      // deadlock retries (a count, not microseconds)
+  PHASE_COUNT
+};
+
+// Timestamps carried along by an EIOBaton.  submit() is called as the op
+// is handed to the pool, which stamps started/finished around the EIO_*
+// function; that function sets retries.
+struct OpTiming {
+  OpTiming(): op(OP_NONE), submitted(0), started(0), finished(0),
+              retries(0) {}
+
+  void submit(LatencyOp o);
+
+  int op;
+  u_int64_t submitted;
+  u_int64_t started;
+  u_int64_t finished;
+  int retries;
+};
+
+
+// A log-linear histogram in the style of HdrHistogram: values under 8 are
+// exact, above that each power of two gets 8 buckets (so within 12.5%).
+// Recording is a couple of atomic adds.
+class Histogram {
+ public:
+  static const int SUB_BUCKETS = 8;
+  static const int SUB_BITS = 3;
+  static const int MAX_EXP = 40;
+  static const int BUCKETS = SUB_BUCKETS * (MAX_EXP - SUB_BITS + 2);
+
+  Histogram();
+
+  void record(u_int64_t value);
+  // Adds our counts to into, zeroing ours if reset (without losing
+  // concurrent records)
+  void drain(Histogram *into, bool reset);
+
+  u_int64_t count() const;
+  u_int64_t percentile(double p) const;
+  u_int64_t max() const;
+  double mean() const;
+
+  static int Bucket(u_int64_t value);
+  static u_int64_t BucketTop(int bucket);
+
+ private:
+  u_int64_t _counts[BUCKETS];
+  u_int64_t _sum;
+};
+
+
+// Per-Db latency histograms for each op and phase.  Histograms are
+// sharded by thread, so the workers and the main thread don't fight over
+// cache lines; shards are allocated the first time a thread records.
+class LatencyStats {
+ public:
+  static const int SHARDS = 16;
+
+  LatencyStats();
+  ~LatencyStats();
+
+  // Queue, exec and retries, from the worker once the op is done
+  void recordWork(const OpTiming &timing);
+  // Completion delay, from the main thread as the callback is about to run
+  void recordComplete(const OpTiming &timing);
+
+  // Merged view of all shards
+  void snapshot(Histogram out[OP_COUNT][PHASE_COUNT], bool reset);
+
+  static u_int64_t Now();
+
+ private:
+  LatencyStats(const LatencyStats &);
+  LatencyStats &operator=(const LatencyStats &);
+
+  struct Shard {
+    Histogram hist[OP_COUNT][PHASE_COUNT];
+  };
+
+  Shard *shard();
+
+  Shard *_shards[SHARDS];
+};
+
+#endif  // BDB_LATENCY_H_
@@ -0,0 +1,116 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bdb_latency.h"
+#include "bdb_maint.h"
+#include "bdb_trickle.h"
+
+Maintainer::Maintainer(DB_ENV *env):
+    _env(env), _config() {
+  memset(&_stats, 0, sizeof(MaintenanceCounters));
+  pthread_mutex_init(&_lock, NULL);
+}
+
+Maintainer::~Maintainer() {
+  stop();
+  pthread_mutex_destroy(&_lock);
+}
+
+int Maintainer::start(const MaintenanceConfig &config) {
+  if (_thread.running() || config.interval <= 0 || config.trickle < 0 ||
+      config.trickle > 100) {
+    return EINVAL;
+  }
+
+  _config = config;
+  return _thread.start(config.interval, Tick, this);
+}
+
+void Maintainer::stop() {
+  _thread.stop();
+}
+
+bool Maintainer::running() const {
+  return _thread.running();
+}
+
+void Maintainer::stats(MaintenanceCounters *out) {
+  pthread_mutex_lock(&_lock);
+  *out = _stats;
+  pthread_mutex_unlock(&_lock);
+}
+
+// Called with _lock held
+void Maintainer::record(StepCounters *step, int rc, u_int64_t usec) {
+  step->runs++;
+  if (rc != 0)
+    step->errors++;
+  step->lastUsec = usec;
+  step->totalUsec += usec;
+  if (usec > step->maxUsec)
+    step->maxUsec = usec;
+}
+
+// Logs that are no longer needed for recovery are removed, or moved to
+// archiveDir for backups to pick up (which needs to be on the same
+// filesystem).
+int Maintainer::archive() {
+  if (_config.archiveDir.empty())
+    return _env->log_archive(_env, NULL, DB_ARCH_REMOVE);
+
+  char **list = NULL;
+  int rc = _env->log_archive(_env, &list, DB_ARCH_ABS);
+  if (rc != 0 || list == NULL)
+    return rc;
+
+  for (char **file = list; *file != NULL; file++) {
+    const char *base = strrchr(*file, '/');
+    base = base == NULL ? *file : base + 1;
+    std::string dest = _config.archiveDir + "/" + base;
+    if (rename(*file, dest.c_str()) != 0 && rc == 0)
+      rc = errno;
+  }
+  free(list);
+  return rc;
+}
+
+void Maintainer::Tick(void *arg) {
+  static_cast<Maintainer *>(arg)->tick();
+}
+
+void Maintainer::tick() {
+  // Trickle first, so the checkpoint has less to write
+  if (_config.trickle > 0) {
+    int written = 0;
+    int clean = 0;
+    bool throttled = false;
+    u_int64_t begin = LatencyStats::Now();
+    int rc = Trickler::Trickle(_env, _config.trickle, NULL, &written, &clean,
+                               &throttled);
+    u_int64_t usec = LatencyStats::Now() - begin;
+    pthread_mutex_lock(&_lock);
+    record(&(_stats.trickle), rc, usec);
+    pthread_mutex_unlock(&_lock);
+  }
+
+  if (_config.checkpoint) {
+    u_int64_t begin = LatencyStats::Now();
+    int rc = _env->txn_checkpoint(_env, _config.kbytes, _config.minutes, 0);
+    u_int64_t usec = LatencyStats::Now() - begin;
+    pthread_mutex_lock(&_lock);
+    record(&(_stats.checkpoint), rc, usec);
+    pthread_mutex_unlock(&_lock);
+  }
+
+  if (_config.archive) {
+    u_int64_t begin = LatencyStats::Now();
+    int rc = archive();
+    u_int64_t usec = LatencyStats::Now() - begin;
+    pthread_mutex_lock(&_lock);
+    record(&(_stats.archive), rc, usec);
+    pthread_mutex_unlock(&_lock);
+  }
+}
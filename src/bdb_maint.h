@@ -0,0 +1,70 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_MAINT_H_
+#define BDB_MAINT_H_
+
+#include <db.h>
+#include <pthread.h>
+
+#include <string>
+
+#include "bdb_periodic.h"
+
+// Timings for one kind of maintenance step, in microseconds
+struct StepCounters {
+  u_int64_t runs;
+  u_int64_t errors;
+  u_int64_t lastUsec;
+  u_int64_t maxUsec;
+  u_int64_t totalUsec;
+};
+
+struct MaintenanceCounters {
+  StepCounters checkpoint;
+  StepCounters archive;
+  StepCounters trickle;
+};
+
+struct MaintenanceConfig {
+  int interval;        // ms between passes
+  bool checkpoint;
+  int kbytes;          // txn_checkpoint() thresholds
+  int minutes;
+  int trickle;         // percent clean to keep, 0 is off
+  bool archive;
+  std::string archiveDir;  // move logs here; empty removes them
+};
+
+
+// A thread, owned by a DbEnv, doing the housekeeping an application would
+// otherwise put on a timer: checkpoints (txn_checkpoint() already skips
+// them until kbytes/minutes is reached), getting rid of log files no
+// longer needed for recovery, and trickling dirty pages.  None of it
+// touches the request path's threads.
+class Maintainer {
+ public:
+  explicit Maintainer(DB_ENV *env);
+  ~Maintainer();
+
+  int start(const MaintenanceConfig &config);
+  void stop();
+  bool running() const;
+  void stats(MaintenanceCounters *out);
+
+ private:
+  Maintainer(const Maintainer &);
+  Maintainer &operator=(const Maintainer &);
+
+  static void Tick(void *arg);
+  void tick();
+  int archive();
+  void record(StepCounters *step, int rc, u_int64_t usec);
+
+  DB_ENV *_env;
+  MaintenanceConfig _config;
+
+  PeriodicThread _thread;
+  pthread_mutex_t _lock;
+  MaintenanceCounters _stats;
+};
+
+#endif  // BDB_MAINT_H_
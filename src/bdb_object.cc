@@ -1,16 +1,45 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <stdlib.h>
+#include <string.h>
+
 #include "bdb_common.h"
 #include "bdb_object.h"
+#include "bdb_txn.h"
 
 #define ERR_MSG(RC)                                                     \
   (RC == -2 ? "ConsistencyError" : db_strerror(RC))
 
+static v8::Persistent<v8::Object> ok_status;
+
+v8::Local<v8::Object> StatusObject(int code) {
+  if (code != 0) {
+    DB_RES(code, ERR_MSG(code), msg);
+    return msg;
+  }
+
+  if (ok_status.IsEmpty()) {
+    v8::PropertyAttribute attrs =
+        static_cast<v8::PropertyAttribute>(v8::ReadOnly | v8::DontDelete);
+    ok_status = v8::Persistent<v8::Object>::New(v8::Object::New());
+    ok_status->Set(status_code_sym, v8::Integer::New(0), attrs);
+    ok_status->Set(err_message_sym, v8::String::New(db_strerror(0)), attrs);
+
+    // Shared by every caller, so nobody gets to hang things off it
+    v8::Local<v8::Object> object = v8::Context::GetCurrent()->Global()->
+        Get(v8::String::NewSymbol("Object"))->ToObject();
+    v8::Local<v8::Function> freeze = v8::Local<v8::Function>::Cast(
+        object->Get(v8::String::NewSymbol("freeze")));
+    v8::Handle<v8::Value> argv[1] = { ok_status };
+    freeze->Call(object, 1, argv);
+  }
+  return v8::Local<v8::Object>::New(ok_status);
+}
+
 int DbObject::EIO_After_ReturnStatus(eio_req *req) {
   v8::HandleScope scope;
   EIOBaton *baton = static_cast<EIOBaton *>(req->data);
-  ev_unref(EV_DEFAULT_UC);
 
-  DB_RES(baton->status, ERR_MSG(baton->status), msg);
+  v8::Local<v8::Object> msg = StatusObject(baton->status);
   v8::Local<v8::Value> argv[1] = { msg };
 
   v8::TryCatch try_catch;
@@ -25,13 +54,95 @@ int DbObject::EIO_After_ReturnStatus(eio_req *req) {
   return 0;
 }
 
-DbObject::DbObject() {}
+DbObject::DbObject(): _queue(0), _latency(0) {}
 DbObject::~DbObject() {}
 
 // Start EIOBaton
 
-EIOBaton::EIOBaton(DbObject *obj): object(obj), flags(0), status(0) {}
+EIOBaton::EIOBaton(DbObject *obj):
+    object(obj), flags(0), status(0), txn(0), timing(),
+    retry(true), txnFlags(0) {}
 
 EIOBaton::~EIOBaton() {
   cb.Dispose();
+  txnHandle.Dispose();
+}
+
+void EIOBaton::setTxn(Txn *t) {
+  txn = t;
+  if (t != NULL)
+    txnHandle = v8::Persistent<v8::Object>::New(t->handle_);
+}
+
+// Start BulkOutput
+
+static void FreeBulkData(char *data, void *hint) {
+  free(data);
+}
+
+BulkOutput::BulkOutput():
+    data(0), length(0), capacity(0), offsets(), _owned(false) {}
+
+BulkOutput::~BulkOutput() {
+  _target.Dispose();
+  if (_owned && data != NULL)
+    free(data);
+}
+
+void BulkOutput::reuse(v8::Handle<v8::Object> buffer) {
+  _target = v8::Persistent<v8::Object>::New(buffer);
+  data = node::Buffer::Data(buffer);
+  capacity = node::Buffer::Length(buffer);
+}
+
+// Makes room for at least `need` more bytes.  The first time this has to
+// grow a caller-supplied buffer we switch over to our own memory.
+bool BulkOutput::reserve(size_t need) {
+  if (capacity - length >= need)
+    return true;
+
+  size_t cap = capacity * 2;
+  if (cap < length + need)
+    cap = length + need;
+  if (cap < 4096)
+    cap = 4096;
+  char *p = static_cast<char *>(_owned ? realloc(data, cap) : malloc(cap));
+  if (p == NULL)
+    return false;
+  if (!_owned && length > 0)
+    memcpy(p, data, length);
+  data = p;
+  capacity = cap;
+  _owned = true;
+  return true;
+}
+
+bool BulkOutput::append(const void *bytes, size_t size) {
+  if (!reserve(size))
+    return false;
+  offsets.push_back(length);
+  offsets.push_back(size);
+  memcpy(data + length, bytes, size);
+  length += size;
+  return true;
+}
+
+// Hands the packed records to JS without another copy.
+v8::Handle<v8::Value> BulkOutput::buffer() {
+  if (_owned) {
+    node::Buffer *buf = node::Buffer::New(data, length, FreeBulkData, NULL);
+    data = NULL;
+    _owned = false;
+    return buf->handle_;
+  }
+  if (!_target.IsEmpty())
+    return _target;
+  return node::Buffer::New(0)->handle_;
+}
+
+v8::Handle<v8::Array> BulkOutput::offsetArray() {
+  v8::Local<v8::Array> arr = v8::Array::New(offsets.size());
+  for (size_t i = 0; i < offsets.size(); i++)
+    arr->Set(v8::Number::New(i), v8::Number::New(offsets[i]));
+  return arr;
 }
@@ -2,11 +2,20 @@
 #ifndef BDB_OBJECT_H_
 #define BDB_OBJECT_H_
 
+#include <db.h>
 #include <node.h>
 #include <v8.h>
 
+#include <vector>
+
+#include "bdb_latency.h"
+#include "bdb_retry.h"
+
+class Cursor;
 class Db;
 class DbEnv;
+class Txn;
+class WorkQueue;
 
 class DbObject: public node::ObjectWrap {
  public:
@@ -16,12 +25,22 @@ class DbObject: public node::ObjectWrap {
  protected:
   static int EIO_After_ReturnStatus(eio_req *req);
 
+  // Where async work goes (NULL means libeio)
+  WorkQueue *_queue;
+
+  // Where async ops record their latencies (a Db's, shared with its
+  // Cursors; NULL for everything else)
+  LatencyStats *_latency;
+
  private:
   DbObject(DbObject &);
   DbObject &operator=(DbObject &);
 
+  friend class Cursor;
   friend class Db;
   friend class DbEnv;
+  friend class Txn;
+  friend class WorkerPool;
 };
 
 
@@ -30,16 +49,57 @@ class EIOBaton {
   explicit EIOBaton(DbObject *obj);
   virtual ~EIOBaton();
 
+  void setTxn(Txn *t);
+
   // make these public to save on typing
   DbObject *object;
   int flags;
   int status;
   v8::Persistent<v8::Function> cb;
 
+  // The caller's transaction, if any (kept alive until we're done)
+  Txn *txn;
+  v8::Persistent<v8::Object> txnHandle;
+
+  OpTiming timing;
+  RetryState retry;
+
+  // For the auto-commit txn, if there is one (DB_TXN_SNAPSHOT, ...)
+  u_int32_t txnFlags;
+
  private:
   EIOBaton();
   EIOBaton(const EIOBaton &);
   EIOBaton &operator=(EIOBaton &);
 };
 
+
+// Packs the records of a bulk read back to back into one block of memory,
+// which is handed to JS as a single Buffer.  Filled on a worker thread;
+// reuse()/buffer()/offsetArray() must run on the main thread.
+class BulkOutput {
+ public:
+  BulkOutput();
+  ~BulkOutput();
+
+  void reuse(v8::Handle<v8::Object> buffer);
+  bool reserve(size_t need);
+  bool append(const void *bytes, size_t size);
+  v8::Handle<v8::Value> buffer();
+  v8::Handle<v8::Array> offsetArray();
+
+  // make these public to save on typing
+  char *data;
+  size_t length;
+  size_t capacity;
+  std::vector<u_int32_t> offsets;
+
+ private:
+  BulkOutput(const BulkOutput &);
+  BulkOutput &operator=(const BulkOutput &);
+
+  bool _owned;
+  v8::Persistent<v8::Object> _target;
+};
+
 #endif  // BDB_OBJECT_H_
@@ -0,0 +1,79 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "bdb_periodic.h"
+
+PeriodicThread::PeriodicThread():
+    _thread(), _running(false), _stopping(false), _interval(0), _fn(NULL),
+    _arg(NULL) {
+  pthread_mutex_init(&_lock, NULL);
+  pthread_cond_init(&_wake, NULL);
+}
+
+PeriodicThread::~PeriodicThread() {
+  stop();
+  pthread_cond_destroy(&_wake);
+  pthread_mutex_destroy(&_lock);
+}
+
+int PeriodicThread::start(int interval, TickFn fn, void *arg) {
+  if (_running || interval <= 0 || fn == NULL)
+    return EINVAL;
+
+  _interval = interval;
+  _fn = fn;
+  _arg = arg;
+  _stopping = false;
+  int rc = pthread_create(&_thread, NULL, Run, this);
+  if (rc != 0)
+    return rc;
+
+  _running = true;
+  return 0;
+}
+
+void PeriodicThread::stop() {
+  if (!_running)
+    return;
+
+  pthread_mutex_lock(&_lock);
+  _stopping = true;
+  pthread_cond_signal(&_wake);
+  pthread_mutex_unlock(&_lock);
+
+  pthread_join(_thread, NULL);
+  _running = false;
+}
+
+bool PeriodicThread::running() const {
+  return _running;
+}
+
+void *PeriodicThread::Run(void *arg) {
+  PeriodicThread *thread = static_cast<PeriodicThread *>(arg);
+  thread->work();
+  return NULL;
+}
+
+void PeriodicThread::work() {
+  pthread_mutex_lock(&_lock);
+  while (!_stopping) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    struct timespec until;
+    uint64_t usec = now.tv_usec + static_cast<uint64_t>(_interval) * 1000;
+    until.tv_sec = now.tv_sec + usec / 1000000;
+    until.tv_nsec = (usec % 1000000) * 1000;
+    pthread_cond_timedwait(&_wake, &_lock, &until);
+    if (_stopping)
+      break;
+    pthread_mutex_unlock(&_lock);
+
+    _fn(_arg);
+
+    pthread_mutex_lock(&_lock);
+  }
+  pthread_mutex_unlock(&_lock);
+}
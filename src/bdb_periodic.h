@@ -0,0 +1,40 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_PERIODIC_H_
+#define BDB_PERIODIC_H_
+
+#include <pthread.h>
+
+// A background thread that calls fn(arg) every interval ms until it's
+// stopped.  The Trickler and the Maintainer are both one of these plus
+// the work they do each time round.  fn is called without any lock held;
+// stop() wakes the thread early and waits for a pass in progress to end.
+class PeriodicThread {
+ public:
+  typedef void (*TickFn)(void *arg);
+
+  PeriodicThread();
+  ~PeriodicThread();
+
+  int start(int interval, TickFn fn, void *arg);
+  void stop();
+  bool running() const;
+
+ private:
+  PeriodicThread(const PeriodicThread &);
+  PeriodicThread &operator=(const PeriodicThread &);
+
+  static void *Run(void *arg);
+  void work();
+
+  pthread_t _thread;
+  bool _running;
+  bool _stopping;
+  int _interval;
+  TickFn _fn;
+  void *_arg;
+
+  pthread_mutex_t _lock;
+  pthread_cond_t _wake;
+};
+
+#endif  // BDB_PERIODIC_H_
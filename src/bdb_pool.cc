@@ -0,0 +1,279 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bdb_latency.h"
+#include "bdb_object.h"
+#include "bdb_pool.h"
+
+WorkQueue::WorkQueue(WorkerPool *p): pool(p), items(), ready(false) {}
+
+
+// A WorkItem waiting out its retry backoff
+struct RetryTimer {
+  ev_timer timer;
+  WorkItem *item;
+};
+
+
+WorkerPool::WorkerPool():
+    _threads(), _queues(), _ready(), _stopping(false), _priority(0),
+    _done(), _outstanding(0) {
+  pthread_mutex_init(&_lock, NULL);
+  pthread_cond_init(&_wake, NULL);
+  pthread_mutex_init(&_doneLock, NULL);
+  ev_async_init(&_notify, Notify);
+  _notify.data = this;
+}
+
+WorkerPool::~WorkerPool() {
+  stop();
+  if (ev_is_active(&_notify)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_async_stop(EV_DEFAULT_UC_ &_notify);
+  }
+  for (size_t i = 0; i < _queues.size(); i++)
+    delete _queues[i];
+  _queues.clear();
+
+  pthread_mutex_destroy(&_doneLock);
+  pthread_cond_destroy(&_wake);
+  pthread_mutex_destroy(&_lock);
+}
+
+int WorkerPool::start(int threads, int priority) {
+  if (running() || threads <= 0)
+    return EINVAL;
+
+  if (!ev_is_active(&_notify)) {
+    ev_async_start(EV_DEFAULT_UC_ &_notify);
+    // Only outstanding work should keep the loop alive, not the watcher
+    ev_unref(EV_DEFAULT_UC);
+  }
+
+  _priority = priority;
+  _stopping = false;
+  for (int i = 0; i < threads; i++) {
+    pthread_t tid;
+    int rc = pthread_create(&tid, NULL, Run, this);
+    if (rc != 0) {
+      stop();
+      return rc;
+    }
+    _threads.push_back(tid);
+  }
+
+  return 0;
+}
+
+// Lets the workers finish whatever is already queued, then joins them.
+void WorkerPool::stop() {
+  if (!running())
+    return;
+
+  pthread_mutex_lock(&_lock);
+  _stopping = true;
+  pthread_cond_broadcast(&_wake);
+  pthread_mutex_unlock(&_lock);
+
+  for (size_t i = 0; i < _threads.size(); i++)
+    pthread_join(_threads[i], NULL);
+  _threads.clear();
+}
+
+bool WorkerPool::running() const {
+  return !_threads.empty();
+}
+
+int WorkerPool::size() const {
+  return _threads.size();
+}
+
+WorkQueue *WorkerPool::createQueue() {
+  WorkQueue *queue = new WorkQueue(this);
+  _queues.push_back(queue);
+  return queue;
+}
+
+void WorkerPool::destroyQueue(WorkQueue *queue) {
+  pthread_mutex_lock(&_lock);
+  for (size_t i = 0; i < _queues.size(); i++) {
+    if (_queues[i] == queue) {
+      _queues.erase(_queues.begin() + i);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_lock);
+  delete queue;
+}
+
+void WorkerPool::Submit(WorkQueue *queue, WorkFn execute, WorkFn finish,
+                        EIOBaton *baton) {
+  WorkItem *item = new WorkItem;
+  memset(&(item->req), 0, sizeof(eio_req));
+  item->execute = execute;
+  item->finish = finish;
+  item->baton = baton;
+  item->queue = queue;
+  item->req.data = baton;
+
+  Dispatch(item);
+}
+
+void WorkerPool::Dispatch(WorkItem *item) {
+  WorkQueue *queue = item->queue;
+  if (queue != NULL && queue->pool->running()) {
+    queue->pool->push(queue, item);
+  } else {
+    eio_custom(EIO_Execute, EIO_PRI_DEFAULT, EIO_Finish, item);
+    ev_ref(EV_DEFAULT_UC);
+  }
+}
+
+void WorkerPool::push(WorkQueue *queue, WorkItem *item) {
+  if (_outstanding++ == 0)
+    ev_ref(EV_DEFAULT_UC);
+
+  pthread_mutex_lock(&_lock);
+  queue->items.push_back(item);
+  if (!queue->ready) {
+    queue->ready = true;
+    _ready.push_back(queue);
+  }
+  pthread_cond_signal(&_wake);
+  pthread_mutex_unlock(&_lock);
+}
+
+void *WorkerPool::Run(void *arg) {
+  WorkerPool *pool = static_cast<WorkerPool *>(arg);
+
+#ifdef __linux__
+  // Best effort: lowering priority always works, raising it needs
+  // privileges we may not have.
+  if (pool->_priority != 0)
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), pool->_priority);
+#endif
+
+  pool->work();
+  return NULL;
+}
+
+void WorkerPool::work() {
+  pthread_mutex_lock(&_lock);
+  for (;;) {
+    while (_ready.empty() && !_stopping)
+      pthread_cond_wait(&_wake, &_lock);
+    if (_ready.empty())
+      break;
+
+    // Round robin: a queue with more work goes to the back of the line
+    WorkQueue *queue = _ready.front();
+    _ready.pop_front();
+    WorkItem *item = queue->items.front();
+    queue->items.pop_front();
+    if (queue->items.empty()) {
+      queue->ready = false;
+    } else {
+      _ready.push_back(queue);
+    }
+    pthread_mutex_unlock(&_lock);
+
+    Execute(item);
+
+    pthread_mutex_lock(&_doneLock);
+    bool wake = _done.empty();
+    _done.push_back(item);
+    pthread_mutex_unlock(&_doneLock);
+    if (wake)
+      ev_async_send(EV_DEFAULT_UC_ &_notify);
+
+    pthread_mutex_lock(&_lock);
+  }
+  pthread_mutex_unlock(&_lock);
+}
+
+void WorkerPool::Notify(EV_P_ ev_async *w, int revents) {
+  WorkerPool *pool = static_cast<WorkerPool *>(w->data);
+  pool->drain();
+}
+
+void WorkerPool::drain() {
+  std::vector<WorkItem *> done;
+
+  pthread_mutex_lock(&_doneLock);
+  done.swap(_done);
+  pthread_mutex_unlock(&_doneLock);
+
+  for (size_t i = 0; i < done.size(); i++) {
+    Finish(done[i]);
+    // After finish(), so work it submits doesn't bounce the loop ref
+    if (--_outstanding == 0)
+      ev_unref(EV_DEFAULT_UC);
+  }
+}
+
+int WorkerPool::EIO_Execute(eio_req *req) {
+  Execute(static_cast<WorkItem *>(req->data));
+  return 0;
+}
+
+int WorkerPool::EIO_Finish(eio_req *req) {
+  ev_unref(EV_DEFAULT_UC);
+  Finish(static_cast<WorkItem *>(req->data));
+  return 0;
+}
+
+// On a worker thread.  The EIO_* function fills in timing.retries.  A
+// deferred retry runs this more than once; exec time counts from the
+// first start, so it includes the backoff.
+void WorkerPool::Execute(WorkItem *item) {
+  OpTiming &timing = item->baton->timing;
+  if (timing.op == OP_NONE) {
+    item->execute(&(item->req));
+    return;
+  }
+
+  if (timing.started == 0)
+    timing.started = LatencyStats::Now();
+  item->execute(&(item->req));
+  timing.finished = LatencyStats::Now();
+  if (item->baton->retry.pending)
+    return;
+
+  LatencyStats *latency = item->baton->object->_latency;
+  if (latency != NULL)
+    latency->recordWork(timing);
+}
+
+// On the main thread.  finish() deletes the baton, so record first.
+void WorkerPool::Finish(WorkItem *item) {
+  RetryState &retry = item->baton->retry;
+  if (retry.pending) {
+    // The timer holds a loop reference until the item is queued again
+    RetryTimer *t = new RetryTimer;
+    t->item = item;
+    retry.pending = false;
+    ev_timer_init(&(t->timer), Retry, retry.delay / 1000000., 0.);
+    t->timer.data = t;
+    ev_timer_start(EV_DEFAULT_UC_ &(t->timer));
+    return;
+  }
+
+  OpTiming &timing = item->baton->timing;
+  LatencyStats *latency = item->baton->object->_latency;
+  if (timing.op != OP_NONE && latency != NULL)
+    latency->recordComplete(timing);
+
+  item->finish(&(item->req));
+  delete item;
+}
+
+void WorkerPool::Retry(EV_P_ ev_timer *w, int revents) {
+  RetryTimer *t = static_cast<RetryTimer *>(w->data);
+  ev_timer_stop(EV_A_ w);
+  Dispatch(t->item);
+  delete t;
+}
@@ -0,0 +1,105 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_POOL_H_
+#define BDB_POOL_H_
+
+#include <pthread.h>
+
+#include <node.h>
+
+#include <deque>
+#include <vector>
+
+class EIOBaton;
+class WorkQueue;
+class WorkerPool;
+
+typedef int (*WorkFn)(eio_req *req);
+
+// One unit of work.  The eio_req is fabricated (only ->data is set) so the
+// existing EIO_* functions run unchanged on either the pool or libeio.
+struct WorkItem {
+  WorkFn execute;
+  WorkFn finish;
+  EIOBaton *baton;
+  WorkQueue *queue;
+  eio_req req;
+};
+
+
+// A submission queue.  Each Db (shared with its Cursors) and each DbEnv
+// gets one, and the workers take turns between queues, so a busy database
+// can't starve the others.
+class WorkQueue {
+ public:
+  explicit WorkQueue(WorkerPool *pool);
+
+  WorkerPool *pool;
+  std::deque<WorkItem *> items;
+  bool ready;
+
+ private:
+  WorkQueue(const WorkQueue &);
+  WorkQueue &operator=(const WorkQueue &);
+};
+
+
+// Native threads owned by a DbEnv, so BDB work doesn't compete with
+// node's own file I/O for libeio's (small) pool.  Work is submitted on the
+// main thread; completions are handed back in batches, with one ev_async
+// wakeup per batch and one loop reference while anything is outstanding.
+class WorkerPool {
+ public:
+  WorkerPool();
+  ~WorkerPool();
+
+  int start(int threads, int priority);
+  void stop();
+  bool running() const;
+  int size() const;
+
+  WorkQueue *createQueue();
+  // For a queue's owner going away.  Anything submitted to it has to be
+  // finished already (every op holds a ref on its object, so it is).
+  void destroyQueue(WorkQueue *queue);
+
+  // Runs execute(req) on a worker and finish(req) back on the main
+  // thread.  Without a (running) pool, falls back to libeio.  If the
+  // baton's timing has an op, its latencies are recorded along the way.
+  // If execute() leaves a deadlock retry pending, the op waits out its
+  // backoff on an event loop timer (not a worker) and is queued again;
+  // finish() only runs once it's really done.
+  static void Submit(WorkQueue *queue, WorkFn execute, WorkFn finish,
+                     EIOBaton *baton);
+
+ private:
+  WorkerPool(const WorkerPool &);
+  WorkerPool &operator=(const WorkerPool &);
+
+  static void *Run(void *arg);
+  static void Notify(EV_P_ ev_async *w, int revents);
+  static int EIO_Execute(eio_req *req);
+  static int EIO_Finish(eio_req *req);
+  static void Execute(WorkItem *item);
+  static void Finish(WorkItem *item);
+  static void Dispatch(WorkItem *item);
+  static void Retry(EV_P_ ev_timer *w, int revents);
+
+  void push(WorkQueue *queue, WorkItem *item);
+  void work();
+  void drain();
+
+  pthread_mutex_t _lock;
+  pthread_cond_t _wake;
+  std::vector<pthread_t> _threads;
+  std::vector<WorkQueue *> _queues;
+  std::deque<WorkQueue *> _ready;
+  bool _stopping;
+  int _priority;
+
+  pthread_mutex_t _doneLock;
+  std::vector<WorkItem *> _done;
+  ev_async _notify;
+  int _outstanding;
+};
+
+#endif  // BDB_POOL_H_
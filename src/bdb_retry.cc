@@ -0,0 +1,57 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bdb_latency.h"
+#include "bdb_retry.h"
+
+static __thread unsigned int jitter_seed = 0;
+
+RetryPolicy::RetryPolicy():
+    retries(0), baseDelay(0), maxDelay(0), maxTime(0), defer(false),
+    retried(0), gaveUp(0) {}
+
+bool RetryPolicy::retry(RetryState *state) {
+  u_int64_t now = LatencyStats::Now();
+  if (state->began == 0)
+    state->began = now;
+
+  if (++state->attempts > retries ||
+      (maxTime > 0 && now - state->began >= static_cast<u_int64_t>(maxTime))) {
+    __sync_fetch_and_add(&gaveUp, 1);
+    return false;
+  }
+  __sync_fetch_and_add(&retried, 1);
+
+  u_int64_t delay = 0;
+  if (baseDelay > 0) {
+    delay = baseDelay;
+    for (int i = 1; i < state->attempts && delay < (1ULL << 40); i++)
+      delay <<= 1;
+    if (maxDelay > 0 && delay > static_cast<u_int64_t>(maxDelay))
+      delay = maxDelay;
+
+    if (jitter_seed == 0)
+      jitter_seed = static_cast<unsigned int>(now) | 1;
+    u_int64_t half = delay / 2;
+    delay = half + (half > 0 ? rand_r(&jitter_seed) % (half + 1) : 0);
+
+    // Don't wait past the deadline just to give up after
+    if (maxTime > 0 && state->began + maxTime < now + delay)
+      delay = state->began + maxTime - now;
+  }
+
+  if (defer && state->deferrable && delay > 0) {
+    state->delay = delay;
+    state->pending = true;
+    return true;
+  }
+
+  if (delay > 0) {
+    usleep(static_cast<useconds_t>(delay));
+  } else {
+    sched_yield();
+  }
+  return true;
+}
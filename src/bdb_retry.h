@@ -0,0 +1,49 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_RETRY_H_
+#define BDB_RETRY_H_
+
+#include <db.h>
+
+// Where one operation is in its retries.  Async ops keep this in their
+// baton, so it survives being sent back to the queue.
+struct RetryState {
+  explicit RetryState(bool deferrable = false):
+      attempts(0), began(0), delay(0), deferrable(deferrable),
+      pending(false) {}
+
+  int attempts;
+  u_int64_t began;
+  u_int64_t delay;     // usec to wait before the pending retry
+  bool deferrable;     // can wait on the event loop instead of a worker
+  bool pending;        // waiting to be run again
+};
+
+
+// How a Db retries an auto-commit operation that lost a deadlock.  The
+// delay before retry n is baseDelay * 2^(n-1), capped at maxDelay, with
+// the top half jittered so losers don't all come back at once.  A
+// baseDelay of 0 just yields, which was the old behavior.
+//
+// Deferred retries go back to the event loop on a timer and are then
+// queued again, rather than sleeping in a worker thread.
+class RetryPolicy {
+ public:
+  RetryPolicy();
+
+  // After a deadlock (the txn is already aborted): true if the op should
+  // run again.  Waits inline, unless the op can be deferred, in which case
+  // state->pending and state->delay are set for the caller to act on.
+  bool retry(RetryState *state);
+
+  int retries;         // most retries per op
+  int baseDelay;       // usec
+  int maxDelay;        // usec
+  int maxTime;         // usec since the first attempt; 0 is no limit
+  bool defer;
+
+  // Updated from the workers
+  u_int64_t retried;
+  u_int64_t gaveUp;
+};
+
+#endif  // BDB_RETRY_H_
@@ -0,0 +1,208 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include "bdb_stats.h"
+
+#define STAT(OBJ, NAME, VAL)                                          \
+  OBJ->Set(v8::String::NewSymbol(NAME),                               \
+           v8::Number::New(static_cast<double>(VAL)))
+
+v8::Local<v8::Object> MpoolStatObject(const DB_MPOOL_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "gbytes", sp->st_gbytes);
+  STAT(obj, "bytes", sp->st_bytes);
+  STAT(obj, "ncache", sp->st_ncache);
+  STAT(obj, "maxNcache", sp->st_max_ncache);
+  STAT(obj, "mmapsize", sp->st_mmapsize);
+  STAT(obj, "pagesize", sp->st_pagesize);
+  STAT(obj, "pages", sp->st_pages);
+  STAT(obj, "map", sp->st_map);
+  STAT(obj, "cacheHit", sp->st_cache_hit);
+  STAT(obj, "cacheMiss", sp->st_cache_miss);
+  STAT(obj, "pageCreate", sp->st_page_create);
+  STAT(obj, "pageIn", sp->st_page_in);
+  STAT(obj, "pageOut", sp->st_page_out);
+  STAT(obj, "roEvict", sp->st_ro_evict);
+  STAT(obj, "rwEvict", sp->st_rw_evict);
+  STAT(obj, "pageTrickle", sp->st_page_trickle);
+  STAT(obj, "pageClean", sp->st_page_clean);
+  STAT(obj, "pageDirty", sp->st_page_dirty);
+  STAT(obj, "hashBuckets", sp->st_hash_buckets);
+  STAT(obj, "hashSearches", sp->st_hash_searches);
+  STAT(obj, "hashLongest", sp->st_hash_longest);
+  STAT(obj, "hashExamined", sp->st_hash_examined);
+  STAT(obj, "hashNowait", sp->st_hash_nowait);
+  STAT(obj, "hashWait", sp->st_hash_wait);
+  STAT(obj, "mvccFrozen", sp->st_mvcc_frozen);
+  STAT(obj, "mvccThawed", sp->st_mvcc_thawed);
+  STAT(obj, "mvccFreed", sp->st_mvcc_freed);
+  STAT(obj, "ioWait", sp->st_io_wait);
+  STAT(obj, "syncInterrupted", sp->st_sync_interrupted);
+  STAT(obj, "regionWait", sp->st_region_wait);
+  STAT(obj, "regionNowait", sp->st_region_nowait);
+  STAT(obj, "regsize", sp->st_regsize);
+  return obj;
+}
+
+v8::Local<v8::Object> LockStatObject(const DB_LOCK_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "maxlocks", sp->st_maxlocks);
+  STAT(obj, "maxlockers", sp->st_maxlockers);
+  STAT(obj, "maxobjects", sp->st_maxobjects);
+  STAT(obj, "partitions", sp->st_partitions);
+  STAT(obj, "nlocks", sp->st_nlocks);
+  STAT(obj, "maxnlocks", sp->st_maxnlocks);
+  STAT(obj, "nlockers", sp->st_nlockers);
+  STAT(obj, "maxnlockers", sp->st_maxnlockers);
+  STAT(obj, "nobjects", sp->st_nobjects);
+  STAT(obj, "maxnobjects", sp->st_maxnobjects);
+  STAT(obj, "nrequests", sp->st_nrequests);
+  STAT(obj, "nreleases", sp->st_nreleases);
+  STAT(obj, "nupgrade", sp->st_nupgrade);
+  STAT(obj, "ndowngrade", sp->st_ndowngrade);
+  STAT(obj, "lockWait", sp->st_lock_wait);
+  STAT(obj, "lockNowait", sp->st_lock_nowait);
+  STAT(obj, "ndeadlocks", sp->st_ndeadlocks);
+  STAT(obj, "locktimeout", sp->st_locktimeout);
+  STAT(obj, "nlocktimeouts", sp->st_nlocktimeouts);
+  STAT(obj, "txntimeout", sp->st_txntimeout);
+  STAT(obj, "ntxntimeouts", sp->st_ntxntimeouts);
+  STAT(obj, "partWait", sp->st_part_wait);
+  STAT(obj, "partNowait", sp->st_part_nowait);
+  STAT(obj, "objsWait", sp->st_objs_wait);
+  STAT(obj, "objsNowait", sp->st_objs_nowait);
+  STAT(obj, "lockersWait", sp->st_lockers_wait);
+  STAT(obj, "lockersNowait", sp->st_lockers_nowait);
+  STAT(obj, "regionWait", sp->st_region_wait);
+  STAT(obj, "regionNowait", sp->st_region_nowait);
+  STAT(obj, "regsize", sp->st_regsize);
+  return obj;
+}
+
+v8::Local<v8::Object> LogStatObject(const DB_LOG_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "lgBsize", sp->st_lg_bsize);
+  STAT(obj, "lgSize", sp->st_lg_size);
+  STAT(obj, "record", sp->st_record);
+  STAT(obj, "wBytes", sp->st_w_bytes);
+  STAT(obj, "wMbytes", sp->st_w_mbytes);
+  STAT(obj, "wcBytes", sp->st_wc_bytes);
+  STAT(obj, "wcMbytes", sp->st_wc_mbytes);
+  STAT(obj, "wcount", sp->st_wcount);
+  STAT(obj, "wcountFill", sp->st_wcount_fill);
+  STAT(obj, "rcount", sp->st_rcount);
+  STAT(obj, "scount", sp->st_scount);
+  STAT(obj, "curFile", sp->st_cur_file);
+  STAT(obj, "curOffset", sp->st_cur_offset);
+  STAT(obj, "diskFile", sp->st_disk_file);
+  STAT(obj, "diskOffset", sp->st_disk_offset);
+  STAT(obj, "maxcommitperflush", sp->st_maxcommitperflush);
+  STAT(obj, "mincommitperflush", sp->st_mincommitperflush);
+  STAT(obj, "regionWait", sp->st_region_wait);
+  STAT(obj, "regionNowait", sp->st_region_nowait);
+  STAT(obj, "regsize", sp->st_regsize);
+  return obj;
+}
+
+v8::Local<v8::Object> TxnStatObject(const DB_TXN_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "nrestores", sp->st_nrestores);
+  STAT(obj, "lastCkpFile", sp->st_last_ckp.file);
+  STAT(obj, "lastCkpOffset", sp->st_last_ckp.offset);
+  STAT(obj, "timeCkp", sp->st_time_ckp);
+  STAT(obj, "lastTxnid", sp->st_last_txnid);
+  STAT(obj, "maxtxns", sp->st_maxtxns);
+  STAT(obj, "nbegins", sp->st_nbegins);
+  STAT(obj, "ncommits", sp->st_ncommits);
+  STAT(obj, "naborts", sp->st_naborts);
+  STAT(obj, "nactive", sp->st_nactive);
+  STAT(obj, "maxnactive", sp->st_maxnactive);
+  STAT(obj, "nsnapshot", sp->st_nsnapshot);
+  STAT(obj, "maxnsnapshot", sp->st_maxnsnapshot);
+  STAT(obj, "regionWait", sp->st_region_wait);
+  STAT(obj, "regionNowait", sp->st_region_nowait);
+  STAT(obj, "regsize", sp->st_regsize);
+  return obj;
+}
+
+v8::Local<v8::Object> MutexStatObject(const DB_MUTEX_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "mutexAlign", sp->st_mutex_align);
+  STAT(obj, "mutexTasSpins", sp->st_mutex_tas_spins);
+  STAT(obj, "mutexCnt", sp->st_mutex_cnt);
+  STAT(obj, "mutexFree", sp->st_mutex_free);
+  STAT(obj, "mutexInuse", sp->st_mutex_inuse);
+  STAT(obj, "mutexInuseMax", sp->st_mutex_inuse_max);
+  STAT(obj, "regionWait", sp->st_region_wait);
+  STAT(obj, "regionNowait", sp->st_region_nowait);
+  STAT(obj, "regsize", sp->st_regsize);
+  return obj;
+}
+
+static v8::Local<v8::Object> BtreeStatObject(const DB_BTREE_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "metaflags", sp->bt_metaflags);
+  STAT(obj, "nkeys", sp->bt_nkeys);
+  STAT(obj, "ndata", sp->bt_ndata);
+  STAT(obj, "pagecnt", sp->bt_pagecnt);
+  STAT(obj, "pagesize", sp->bt_pagesize);
+  STAT(obj, "minkey", sp->bt_minkey);
+  STAT(obj, "reLen", sp->bt_re_len);
+  STAT(obj, "levels", sp->bt_levels);
+  STAT(obj, "intPg", sp->bt_int_pg);
+  STAT(obj, "leafPg", sp->bt_leaf_pg);
+  STAT(obj, "dupPg", sp->bt_dup_pg);
+  STAT(obj, "overPg", sp->bt_over_pg);
+  STAT(obj, "emptyPg", sp->bt_empty_pg);
+  STAT(obj, "free", sp->bt_free);
+  STAT(obj, "intPgfree", sp->bt_int_pgfree);
+  STAT(obj, "leafPgfree", sp->bt_leaf_pgfree);
+  STAT(obj, "dupPgfree", sp->bt_dup_pgfree);
+  STAT(obj, "overPgfree", sp->bt_over_pgfree);
+  return obj;
+}
+
+static v8::Local<v8::Object> HashStatObject(const DB_HASH_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "metaflags", sp->hash_metaflags);
+  STAT(obj, "nkeys", sp->hash_nkeys);
+  STAT(obj, "ndata", sp->hash_ndata);
+  STAT(obj, "pagecnt", sp->hash_pagecnt);
+  STAT(obj, "pagesize", sp->hash_pagesize);
+  STAT(obj, "ffactor", sp->hash_ffactor);
+  STAT(obj, "buckets", sp->hash_buckets);
+  STAT(obj, "free", sp->hash_free);
+  STAT(obj, "bfree", sp->hash_bfree);
+  STAT(obj, "bigpages", sp->hash_bigpages);
+  STAT(obj, "bigBfree", sp->hash_big_bfree);
+  STAT(obj, "overflows", sp->hash_overflows);
+  STAT(obj, "ovflFree", sp->hash_ovfl_free);
+  STAT(obj, "dup", sp->hash_dup);
+  STAT(obj, "dupFree", sp->hash_dup_free);
+  return obj;
+}
+
+static v8::Local<v8::Object> QueueStatObject(const DB_QUEUE_STAT *sp) {
+  v8::Local<v8::Object> obj = v8::Object::New();
+  STAT(obj, "metaflags", sp->qs_metaflags);
+  STAT(obj, "nkeys", sp->qs_nkeys);
+  STAT(obj, "ndata", sp->qs_ndata);
+  STAT(obj, "pagesize", sp->qs_pagesize);
+  STAT(obj, "extentsize", sp->qs_extentsize);
+  STAT(obj, "pages", sp->qs_pages);
+  STAT(obj, "reLen", sp->qs_re_len);
+  STAT(obj, "pgfree", sp->qs_pgfree);
+  STAT(obj, "firstRecno", sp->qs_first_recno);
+  STAT(obj, "curRecno", sp->qs_cur_recno);
+  return obj;
+}
+
+v8::Local<v8::Object> DbStatObject(DBTYPE type, const void *sp) {
+  switch (type) {
+    case DB_HASH:
+      return HashStatObject(static_cast<const DB_HASH_STAT *>(sp));
+    case DB_QUEUE:
+      return QueueStatObject(static_cast<const DB_QUEUE_STAT *>(sp));
+    default:
+      // Recno shares the btree structure
+      return BtreeStatObject(static_cast<const DB_BTREE_STAT *>(sp));
+  }
+}
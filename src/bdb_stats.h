@@ -0,0 +1,21 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_STATS_H_
+#define BDB_STATS_H_
+
+#include <db.h>
+
+#include <node.h>
+
+// Plain JS objects (numbers only) from BDB's *_stat() structures.  Names
+// are the BDB field names without the prefix, camelCased (st_cache_hit is
+// cacheHit).
+v8::Local<v8::Object> MpoolStatObject(const DB_MPOOL_STAT *sp);
+v8::Local<v8::Object> LockStatObject(const DB_LOCK_STAT *sp);
+v8::Local<v8::Object> LogStatObject(const DB_LOG_STAT *sp);
+v8::Local<v8::Object> TxnStatObject(const DB_TXN_STAT *sp);
+v8::Local<v8::Object> MutexStatObject(const DB_MUTEX_STAT *sp);
+
+// sp is whatever DB->stat() returned for a database of this type
+v8::Local<v8::Object> DbStatObject(DBTYPE type, const void *sp);
+
+#endif  // BDB_STATS_H_
@@ -0,0 +1,114 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bdb_trickle.h"
+
+Trickler::Trickler(DB_ENV *env):
+    _env(env), _percent(0), _perPass(0), _budget(0) {
+  memset(&_stats, 0, sizeof(TrickleCounters));
+  pthread_mutex_init(&_lock, NULL);
+}
+
+Trickler::~Trickler() {
+  stop();
+  pthread_mutex_destroy(&_lock);
+}
+
+int Trickler::start(int percent, int rate, int interval) {
+  if (_thread.running() || percent <= 0 || percent > 100 || rate < 0 ||
+      interval <= 0) {
+    return EINVAL;
+  }
+
+  _percent = percent;
+  _perPass = static_cast<int64_t>(rate) * interval / 1000;
+  _budget = 0;
+  return _thread.start(interval, Tick, this);
+}
+
+void Trickler::stop() {
+  _thread.stop();
+}
+
+bool Trickler::running() const {
+  return _thread.running();
+}
+
+void Trickler::stats(TrickleCounters *out) {
+  pthread_mutex_lock(&_lock);
+  *out = _stats;
+  pthread_mutex_unlock(&_lock);
+}
+
+int Trickler::Trickle(DB_ENV *env, int percent, int64_t *budget,
+                      int *written, int *clean, bool *throttled) {
+  *written = 0;
+  *throttled = false;
+
+  DB_MPOOL_STAT *gsp = NULL;
+  int rc = env->memp_stat(env, &gsp, NULL, 0);
+  if (rc != 0)
+    return rc;
+
+  // Same arithmetic memp_trickle() does: buffers that aren't dirty (even
+  // if unused) count as clean
+  u_int64_t pages = gsp->st_pages;
+  u_int64_t dirty = gsp->st_page_dirty < pages ? gsp->st_page_dirty : pages;
+  u_int64_t pagesize = gsp->st_pagesize;
+  free(gsp);
+
+  *clean = pages == 0 ? 100 : static_cast<int>((pages - dirty) * 100 / pages);
+  if (*clean >= percent)
+    return 0;
+
+  // memp_trickle() writes until a percent target is met, so throttle by
+  // asking for less: the largest percent that the budget covers.  On a big
+  // cache 1% is a lot of pages, so that can be nothing at all this pass;
+  // the budget then builds up until it covers the next step.
+  int target = percent;
+  if (budget != NULL && pagesize > 0) {
+    u_int64_t want = (pages * percent / 100) - (pages - dirty);
+    u_int64_t allowed = *budget > 0 ? *budget / pagesize : 0;
+    if (allowed < want) {
+      *throttled = true;
+      target = static_cast<int>((pages - dirty + allowed) * 100 / pages);
+      if (pages * target / 100 <= pages - dirty)
+        return 0;
+    }
+  }
+
+  rc = env->memp_trickle(env, target, written);
+  if (budget != NULL)
+    *budget -= static_cast<int64_t>(*written) * pagesize;
+  return rc;
+}
+
+void Trickler::Tick(void *arg) {
+  static_cast<Trickler *>(arg)->tick();
+}
+
+void Trickler::tick() {
+  int written = 0;
+  int clean = 0;
+  bool throttled = false;
+  if (_perPass > 0)
+    _budget += _perPass;
+  int rc = Trickle(_env, _percent, _perPass > 0 ? &_budget : NULL, &written,
+                   &clean, &throttled);
+  // Only bank budget while there's a backlog, or a quiet spell would save
+  // up for one big burst later
+  if (!throttled && _budget > _perPass)
+    _budget = _perPass;
+
+  pthread_mutex_lock(&_lock);
+  _stats.runs++;
+  if (rc == 0) {
+    _stats.pagesWritten += written;
+    _stats.cleanPercent = clean;
+    if (throttled)
+      _stats.throttled++;
+  }
+  pthread_mutex_unlock(&_lock);
+}
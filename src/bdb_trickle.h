@@ -0,0 +1,62 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_TRICKLE_H_
+#define BDB_TRICKLE_H_
+
+#include <db.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "bdb_periodic.h"
+
+// Counters, copied out under the lock for trickleStats()
+struct TrickleCounters {
+  u_int64_t runs;
+  u_int64_t pagesWritten;
+  u_int64_t throttled;
+  int cleanPercent;
+};
+
+
+// A thread, owned by a DbEnv, that writes dirty pages out of the cache in
+// the background with memp_trickle().  Keeping a share of the cache clean
+// means foreground gets don't have to write a page before they can evict
+// it, and leaves less for a checkpoint to flush at once.
+//
+// Every interval it looks at how much of the cache is clean; if that's
+// under the target, it trickles toward the target, but no more than
+// `rate` bytes/second worth of pages (0 is unlimited).  Budget a pass
+// doesn't get to use carries over to the next, for as long as there's
+// still something to write.
+class Trickler {
+ public:
+  explicit Trickler(DB_ENV *env);
+  ~Trickler();
+
+  int start(int percent, int rate, int interval);
+  void stop();
+  bool running() const;
+  void stats(TrickleCounters *out);
+
+  // One pass.  With a budget, writes at most *budget bytes and takes
+  // what it wrote off it (NULL is no limit).  Returns a BDB error, or 0.
+  static int Trickle(DB_ENV *env, int percent, int64_t *budget,
+                     int *written, int *clean, bool *throttled);
+
+ private:
+  Trickler(const Trickler &);
+  Trickler &operator=(const Trickler &);
+
+  static void Tick(void *arg);
+  void tick();
+
+  DB_ENV *_env;
+  int _percent;
+  int64_t _perPass;    // bytes of budget each pass adds; 0 is no limit
+  int64_t _budget;     // what's left to spend
+
+  PeriodicThread _thread;
+  pthread_mutex_t _lock;
+  TrickleCounters _stats;
+};
+
+#endif  // BDB_TRICKLE_H_
@@ -0,0 +1,240 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#include <errno.h>
+
+#include <algorithm>
+
+#include "bdb_common.h"
+#include "bdb_env.h"
+#include "bdb_pool.h"
+#include "bdb_txn.h"
+
+using v8::FunctionTemplate;
+
+v8::Persistent<v8::FunctionTemplate> Txn::constructor_template;
+
+Txn::Txn(): DbObject(), _txn(0), _cursors(0), _parent(0), _children() {
+  pthread_mutex_init(&_lock, NULL);
+}
+
+Txn::~Txn() {
+  // The parent may be resolving on a worker right now
+  if (_parent != NULL)
+    _parent->lock();
+
+  // Never resolved by JS, so nothing in it can be trusted
+  if (_txn != NULL) {
+    _txn->abort(_txn);
+    _txn = NULL;
+  }
+  resolveChildren();
+
+  if (_parent != NULL) {
+    std::vector<Txn *> &siblings = _parent->_children;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), this),
+                   siblings.end());
+    _parent->unlock();
+  }
+  _parentHandle.Dispose();
+  _envHandle.Dispose();
+  pthread_mutex_destroy(&_lock);
+}
+
+DB_TXN *Txn::getDB_TXN() {
+  return _txn;
+}
+
+void Txn::lock() {
+  pthread_mutex_lock(&_lock);
+}
+
+void Txn::unlock() {
+  pthread_mutex_unlock(&_lock);
+}
+
+void Txn::addCursor() {
+  _cursors++;
+}
+
+void Txn::removeCursor() {
+  _cursors--;
+}
+
+bool Txn::hasCursors() {
+  if (_cursors > 0)
+    return true;
+
+  for (size_t i = 0; i < _children.size(); i++) {
+    Txn *child = _children[i];
+    child->lock();
+    bool busy = child->_txn != NULL && child->hasCursors();
+    child->unlock();
+    if (busy)
+      return true;
+  }
+  return false;
+}
+
+// BDB resolved our children along with us
+void Txn::resolveChildren() {
+  for (size_t i = 0; i < _children.size(); i++) {
+    Txn *child = _children[i];
+    child->lock();
+    child->_txn = NULL;
+    child->resolveChildren();
+    child->unlock();
+  }
+}
+
+int Txn::resolve(bool commit, u_int32_t flags) {
+  // Resolving a child changes its parent's DB_TXN too
+  if (_parent != NULL)
+    _parent->lock();
+  lock();
+
+  int rc = 0;
+  if (_txn == NULL || hasCursors()) {
+    rc = EINVAL;
+  } else {
+    rc = commit ? _txn->commit(_txn, flags) : _txn->abort(_txn);
+    _txn = NULL;
+    resolveChildren();
+  }
+
+  unlock();
+  if (_parent != NULL)
+    _parent->unlock();
+
+  return rc;
+}
+
+bool Txn::HasInstance(v8::Handle<v8::Value> val) {
+  if (!val->IsObject())
+    return false;
+  return constructor_template->HasInstance(val->ToObject());
+}
+
+// Start EIO Methods
+
+int Txn::EIO_Commit(eio_req *req) {
+  EIOBaton *baton = static_cast<EIOBaton *>(req->data);
+  Txn *txn = dynamic_cast<Txn *>(baton->object);
+
+  baton->status = txn->resolve(true, baton->flags);
+
+  return 0;
+}
+
+int Txn::EIO_Abort(eio_req *req) {
+  EIOBaton *baton = static_cast<EIOBaton *>(req->data);
+  Txn *txn = dynamic_cast<Txn *>(baton->object);
+
+  baton->status = txn->resolve(false, 0);
+
+  return 0;
+}
+
+// Start V8 Exposed Methods
+
+v8::Handle<v8::Value> Txn::New(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  REQ_OBJ_ARG(0, envObj);
+  REQ_INT_ARG(2, flags);
+
+  DbEnv *env = node::ObjectWrap::Unwrap<DbEnv>(envObj);
+  if (!env->isTransactional())
+    RET_EXC("environment is not transactional");
+
+  Txn *parent = NULL;
+  if (HasInstance(args[1]))
+    parent = node::ObjectWrap::Unwrap<Txn>(args[1]->ToObject());
+
+  Txn *txn = new Txn();
+  txn->Wrap(args.This());
+
+  // The parent's commit/abort may already be queued
+  if (parent != NULL) {
+    parent->lock();
+    if (parent->_txn == NULL) {
+      parent->unlock();
+      RET_EXC("parent transaction is already resolved");
+    }
+  }
+
+  DB_ENV *&dbenv = env->getDB_ENV();
+  if (dbenv == NULL) {
+    if (parent != NULL)
+      parent->unlock();
+    RET_EXC("environment is closed");
+  }
+  int rc = dbenv->txn_begin(dbenv,
+                            parent != NULL ? parent->_txn : NULL,
+                            &(txn->_txn),
+                            flags);
+  if (rc != 0) {
+    txn->_txn = NULL;
+    if (parent != NULL)
+      parent->unlock();
+    RET_EXC(db_strerror(rc));
+  }
+
+  if (parent != NULL) {
+    txn->_parent = parent;
+    txn->_parentHandle = v8::Persistent<v8::Object>::New(parent->handle_);
+    parent->_children.push_back(txn);
+    parent->unlock();
+  }
+
+  // The environment has to outlive us
+  txn->_envHandle = v8::Persistent<v8::Object>::New(envObj);
+  txn->_queue = env->_queue;
+
+  return args.This();
+}
+
+v8::Handle<v8::Value> Txn::Commit(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  Txn *txn = node::ObjectWrap::Unwrap<Txn>(args.This());
+
+  REQ_INT_ARG(0, flags);
+  REQ_FN_ARG(1, cb);
+
+  EIOBaton *baton = new EIOBaton(txn);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+  baton->flags = flags;
+
+  txn->Ref();
+  WorkerPool::Submit(txn->_queue, EIO_Commit, EIO_After_ReturnStatus, baton);
+
+  return v8::Undefined();
+}
+
+v8::Handle<v8::Value> Txn::Abort(const v8::Arguments &args) {
+  v8::HandleScope scope;
+
+  Txn *txn = node::ObjectWrap::Unwrap<Txn>(args.This());
+
+  REQ_FN_ARG(0, cb);
+
+  EIOBaton *baton = new EIOBaton(txn);
+  baton->cb = v8::Persistent<v8::Function>::New(cb);
+
+  txn->Ref();
+  WorkerPool::Submit(txn->_queue, EIO_Abort, EIO_After_ReturnStatus, baton);
+
+  return v8::Undefined();
+}
+
+void Txn::Initialize(v8::Handle<v8::Object> target) {
+  v8::HandleScope scope;
+
+  v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(New);
+  constructor_template = v8::Persistent<v8::FunctionTemplate>::New(t);
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  NODE_SET_PROTOTYPE_METHOD(t, "_abort", Abort);
+  NODE_SET_PROTOTYPE_METHOD(t, "_commit", Commit);
+
+  target->Set(v8::String::NewSymbol("Txn"), t->GetFunction());
+}
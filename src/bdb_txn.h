@@ -0,0 +1,74 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+#ifndef BDB_TXN_H_
+#define BDB_TXN_H_
+
+#include <db.h>
+#include <pthread.h>
+
+#include <vector>
+
+#include "bdb_object.h"
+
+// A transaction held open by JS across any number of get/put/del/cursor
+// calls.  BDB doesn't let two threads use a DB_TXN at the same time, so
+// every operation (which may land on any eio thread) holds lock() while
+// it runs.
+//
+// BDB won't resolve a transaction with open cursors (it panics the env),
+// so commit/abort fail with EINVAL until every Cursor opened in the Txn
+// (or in one of its children) is closed.  Resolving a parent resolves
+// its children too; they're marked that way, so later calls on them fail
+// with EINVAL instead of touching a freed DB_TXN.  Locks are always taken
+// parent first.
+class Txn: public DbObject {
+ public:
+  Txn();
+  virtual ~Txn();
+
+  static void Initialize(v8::Handle<v8::Object> target);
+  static bool HasInstance(v8::Handle<v8::Value> val);
+
+  static v8::Handle<v8::Value> Abort(const v8::Arguments &);
+  static v8::Handle<v8::Value> Commit(const v8::Arguments &);
+  static v8::Handle<v8::Value> New(const v8::Arguments &);
+
+  DB_TXN *getDB_TXN();
+  void lock();
+  void unlock();
+
+  // A Cursor opened/closed in us; call with lock() held
+  void addCursor();
+  void removeCursor();
+
+ private:
+  Txn(const Txn &);
+  Txn &operator=(const Txn &);
+
+  static int EIO_Abort(eio_req *req);
+  static int EIO_Commit(eio_req *req);
+
+  int resolve(bool commit, u_int32_t flags);
+  // With lock() held
+  bool hasCursors();
+  void resolveChildren();
+
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  DB_TXN *_txn;
+  pthread_mutex_t _lock;
+  v8::Persistent<v8::Object> _envHandle;
+  int _cursors;
+
+  // A child keeps its parent alive; the parent's list is only changed
+  // under its lock
+  Txn *_parent;
+  v8::Persistent<v8::Object> _parentHandle;
+  std::vector<Txn *> _children;
+};
+
+#define OPT_TXN_ARG(I, VAR)                                     \
+  Txn *VAR = NULL;                                              \
+  if (args.Length() > (I) && Txn::HasInstance(args[I]))         \
+    VAR = node::ObjectWrap::Unwrap<Txn>(args[I]->ToObject());
+
+#endif  // BDB_TXN_H_
@@ -0,0 +1,109 @@
+/* Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved. */
+/*
+ * A toy codec for test_codec.js: run-length encoding, with the dictionary
+ * standing in for a prefix every value is expected to start with.
+ *
+ *   cc -shared -fPIC -o rle.so codec_rle.c
+ */
+#include <stdlib.h>
+#include <string.h>
+
+struct rle {
+  size_t len;
+  unsigned char dict[1];
+};
+
+void *rle_init(const void *dict, size_t len) {
+  struct rle *ctx = malloc(sizeof(struct rle) + len);
+  if (ctx == NULL)
+    return NULL;
+  ctx->len = len;
+  if (len > 0)
+    memcpy(ctx->dict, dict, len);
+  return ctx;
+}
+
+void rle_free(void *ctx) {
+  free(ctx);
+}
+
+size_t rle_bound(void *ctx, size_t len) {
+  return 1 + 2 * len;
+}
+
+/* The longest prefix all the samples share */
+size_t rle_train(const void *samples, const size_t *sizes, unsigned count,
+                 void *dict, size_t cap) {
+  const unsigned char *first = samples;
+  const unsigned char *p = samples;
+  size_t len = count > 0 ? sizes[0] : 0;
+  unsigned i;
+  size_t j;
+
+  for (i = 0; i < count; i++) {
+    for (j = 0; j < len && j < sizes[i] && p[j] == first[j]; j++)
+      ;
+    len = j;
+    p += sizes[i];
+  }
+  if (len > cap)
+    len = cap;
+  memcpy(dict, first, len);
+  return len;
+}
+
+int rle_compress(void *arg, const void *src, size_t len, void *dst,
+                 size_t cap, size_t *outlen) {
+  struct rle *ctx = arg;
+  const unsigned char *in = src;
+  unsigned char *out = dst;
+  size_t i = 0;
+  size_t o = 1;
+
+  /* First byte: 1 if the dictionary prefix was dropped */
+  out[0] = 0;
+  if (ctx != NULL && ctx->len > 0 && len >= ctx->len &&
+      memcmp(in, ctx->dict, ctx->len) == 0) {
+    out[0] = 1;
+    i = ctx->len;
+  }
+  while (i < len) {
+    size_t run = 1;
+    while (i + run < len && run < 255 && in[i + run] == in[i])
+      run++;
+    if (o + 2 > cap)
+      return -1;
+    out[o++] = (unsigned char)run;
+    out[o++] = in[i];
+    i += run;
+  }
+  *outlen = o;
+  return 0;
+}
+
+int rle_decompress(void *arg, const void *src, size_t len, void *dst,
+                   size_t rawlen) {
+  struct rle *ctx = arg;
+  const unsigned char *in = src;
+  unsigned char *out = dst;
+  size_t i = 1;
+  size_t o = 0;
+
+  if (len < 1)
+    return -1;
+  if (in[0] == 1) {
+    if (ctx == NULL || ctx->len > rawlen)
+      return -1;
+    memcpy(out, ctx->dict, ctx->len);
+    o = ctx->len;
+  }
+  while (i < len) {
+    size_t run = in[i];
+    if (i + 1 >= len || o + run > rawlen)
+      return -1;
+    memset(out + o, in[i + 1], run);
+    o += run;
+    i += 2;
+  }
+  return o == rawlen ? 0 : -1;
+}
@@ -0,0 +1,83 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var MB = 1024 * 1024;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home: env_location,
+                         cacheSize: 8 * MB,
+                         cacheRegions: 4,
+                         cacheMax: 32 * MB,
+                         mmapSize: 16 * MB});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.getCacheSize();
+assert.equal(0, stat.code, stat.message);
+assert.equal(4, stat.regions);
+assert.ok(stat.size >= 8 * MB, 'cache is ' + stat.size);
+var initial = stat.size;
+
+// Too late to change the ceiling once open
+assert.notEqual(0, env.setCacheMax(64 * MB).code);
+
+// ...but setCacheSize() turns into a resize
+stat = env.setCacheSize({size: 12 * MB});
+assert.equal(0, stat.code, stat.message);
+stat = env.getCacheSize();
+assert.equal(0, stat.code, stat.message);
+assert.ok(stat.size > initial, 'cache did not grow: ' + stat.size);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var key = new Buffer(helper.uuid());
+var val = new Buffer(helper.uuid());
+stat = db.putSync({key: key, val: val});
+assert.equal(0, stat.code, stat.message);
+
+env.resizeCache(16 * MB, function(res) {
+  assert.equal(0, res.code, res.message);
+  stat = env.getCacheSize();
+  assert.equal(0, stat.code, stat.message);
+  assert.ok(stat.size > initial, 'cache did not grow: ' + stat.size);
+
+  env.resizeCache(4 * MB, function(res) {
+    assert.equal(0, res.code, res.message);
+    stat = env.getCacheSize();
+    assert.ok(stat.size < initial, 'cache did not shrink: ' + stat.size);
+
+    // Everything is still there after losing regions
+    db.get({key: key}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(val.toString(), data.toString());
+
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+
+      // The DB_ENV is gone; nothing may touch it now
+      assert.equal(bdb.FLAGS.EINVAL, env.closeSync().code);
+      assert.equal(bdb.FLAGS.EINVAL, env.getCacheSize().code);
+      assert.equal(bdb.FLAGS.EINVAL, env.startTrickle().code);
+      assert.equal(bdb.FLAGS.EINVAL, env.startMaintenance().code);
+      assert.throws(function() { env.txnBegin(); });
+      assert.throws(function() { new bdb.Db(env); });
+      env.resizeCache(8 * MB, function(res) {
+        assert.equal(bdb.FLAGS.EINVAL, res.code);
+        exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+        console.log('test_cache: PASSED');
+      });
+    });
+  });
+});
@@ -0,0 +1,127 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 500;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home:env_location, cdb: true});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.setThreadPool({threads: 4});
+assert.equal(0, stat.code, stat.message);
+
+// The default DB_AUTO_COMMIT has to be dropped for this to work
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var key = new Buffer(helper.uuid());
+var first = new Buffer(helper.uuid());
+var second = new Buffer(helper.uuid());
+
+function concurrent(callback) {
+  var finished = 0;
+  for (var i = 0; i < ITERATIONS; i++) {
+    (function() {
+      var k = new Buffer(helper.uuid());
+      var v = new Buffer(helper.uuid());
+      db.put({key: k, val: v}, function(res) {
+        assert.equal(0, res.code, res.message);
+        db.get({key: k}, function(res, data) {
+          assert.equal(0, res.code, res.message);
+          assert.equal(v, data.toString(encoding='utf8'), 'Data mismatch');
+          db.del({key: k}, function(res) {
+            assert.equal(0, res.code, res.message);
+            if (++finished === ITERATIONS)
+              callback();
+          });
+        });
+      });
+    })();
+  }
+}
+
+// Writes made while a stream is open are held until it closes, however
+// many there are; none of them gets a pool thread to block on meanwhile.
+function held(callback) {
+  var WRITES = 16;  // more than the 4 pool threads
+  var stream = db.createReadStream();
+  var closed = false;
+  var written = 0;
+  var issued = false;
+
+  stream.on('data', function() {
+    if (issued)
+      return;
+    issued = true;
+
+    var stat = db.putSync({key: new Buffer('held'), val: first});
+    assert.equal(bdb.FLAGS.EINVAL, stat.code, stat.message);
+    stat = db.delSync({key: key});
+    assert.equal(bdb.FLAGS.EINVAL, stat.code, stat.message);
+
+    for (var i = 0; i < WRITES; i++) {
+      db.put({key: new Buffer('held-' + i), val: first}, function(res) {
+        assert.equal(0, res.code, res.message);
+        assert.ok(closed, 'write ran under an open stream');
+        if (++written < WRITES)
+          return;
+
+        db.get({key: new Buffer('held-' + (WRITES - 1))}, function(res, data) {
+          assert.equal(0, res.code, res.message);
+          assert.equal(first, data.toString(encoding='utf8'));
+          callback();
+        });
+      });
+    }
+  });
+  stream.on('error', function(err) {
+    assert.ok(false, err);
+  });
+  stream.on('close', function() {
+    closed = true;
+  });
+}
+
+db.put({key: key, val: first}, function(res) {
+  assert.equal(0, res.code, res.message);
+
+  // Wrong old value: nothing changes
+  db.putIf({key: key, val: second, oldVal: second}, function(res) {
+    assert.equal(-2, res.code, res.message);
+    db.get({key: key}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(first, data.toString(encoding='utf8'), 'putIf wrote');
+
+      // Right one: swapped under the write cursor
+      db.putIf({key: key, val: second, oldVal: first}, function(res) {
+        assert.equal(0, res.code, res.message);
+        db.get({key: key}, function(res, data) {
+          assert.equal(0, res.code, res.message);
+          assert.equal(second, data.toString(encoding='utf8'),
+                       'putIf didn\'t write');
+
+          held(function() {
+            concurrent(function() {
+              stat = db.closeSync();
+              assert.equal(0, stat.code, stat.message);
+              stat = env.closeSync();
+              assert.equal(0, stat.code, stat.message);
+              console.log('test_cdb: PASSED');
+              exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+            });
+          });
+        });
+      });
+    });
+  });
+});
@@ -0,0 +1,190 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup: codec_rle.c is a toy run-length codec with the exports
+// bdb_codec.h wants
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var lib = env_location + '/rle.so';
+var file = helper.uuid();
+var MIN_SIZE = 16;
+var MAGIC = [0xf5, 0x42, 0x44, 0x43];
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+function sameBytes(a, b) {
+  if (a.length !== b.length)
+    return false;
+  for (var i = 0; i < a.length; i++) {
+    if (a[i] !== b[i])
+      return false;
+  }
+  return true;
+}
+
+function fill(c, n) {
+  var b = new Buffer(n);
+  for (var i = 0; i < n; i++)
+    b[i] = c.charCodeAt(0);
+  return b;
+}
+
+function tagged(b) {
+  if (b.length < MAGIC.length)
+    return false;
+  for (var i = 0; i < MAGIC.length; i++) {
+    if (b[i] !== MAGIC[i])
+      return false;
+  }
+  return true;
+}
+
+// Values written before there was a codec
+var legacy = {
+  'legacy-0': new Buffer([0x00, 0x68, 0x65, 0x6c, 0x6c, 0x6f]),
+  'legacy-1': new Buffer([0x01, 0x05, 0x61, 0x03, 0x62]),
+  'legacy-x': fill('x', 100)
+};
+
+function writeLegacy() {
+  var db = new BDB.Db(env);
+  stat = db.openSync({env: env, file: file});
+  assert.equal(0, stat.code, stat.message);
+  for (var k in legacy) {
+    stat = db.putSync({key: new Buffer(k), val: legacy[k]});
+    assert.equal(0, stat.code, stat.message);
+  }
+  stat = db.closeSync();
+  assert.equal(0, stat.code, stat.message);
+}
+
+function openCodec(dictionary) {
+  var db = new BDB.Db(env);
+  stat = db.setCodec({lib: lib, prefix: 'rle', minSize: MIN_SIZE,
+                      dictionary: dictionary});
+  assert.equal(0, stat.code, stat.message);
+  stat = db.openSync({env: env, file: file});
+  assert.equal(0, stat.code, stat.message);
+  return db;
+}
+
+// What's actually on disk, through a handle without the codec
+function stored(key) {
+  var db = new BDB.Db(env);
+  stat = db.openSync({env: env, file: file});
+  assert.equal(0, stat.code, stat.message);
+  var res = db.getSync({key: new Buffer(key)});
+  assert.equal(0, res.code, res.message);
+  db.closeSync();
+  return res.value;
+}
+
+function roundTrip(db, key, val) {
+  stat = db.putSync({key: new Buffer(key), val: val});
+  assert.equal(0, stat.code, stat.message);
+  var res = db.getSync({key: new Buffer(key)});
+  assert.equal(0, res.code, res.message);
+  assert.ok(sameBytes(val, res.value), key + ' round trip');
+}
+
+function basics(callback) {
+  var db = openCodec(null);
+
+  // Untagged values come back as they were written
+  for (var k in legacy) {
+    var res = db.getSync({key: new Buffer(k)});
+    assert.equal(0, res.code, res.message);
+    assert.ok(sameBytes(legacy[k], res.value), k + ' was misread');
+  }
+
+  // Compressible values are stored tagged and smaller
+  var big = fill('a', 1000);
+  roundTrip(db, 'big', big);
+  var raw = stored('big');
+  assert.ok(tagged(raw), 'big value not compressed');
+  assert.ok(raw.length < big.length);
+
+  // Short values are stored raw
+  var small = new Buffer('aaaaaaaa');
+  roundTrip(db, 'small', small);
+  assert.ok(sameBytes(small, stored('small')), 'small value was encoded');
+
+  // So are values that don't shrink
+  var noisy = new Buffer('abcdefghijklmnopqrstuvwxyz0123456789');
+  roundTrip(db, 'noisy', noisy);
+  assert.ok(sameBytes(noisy, stored('noisy')), 'noisy value was encoded');
+
+  // Values that look like a header get escaped
+  var fake = new Buffer([0xf5, 0x42, 0x44, 0x43, 0x01, 0x00, 0x41, 0x41]);
+  roundTrip(db, 'fake', fake);
+  assert.ok(tagged(stored('fake')), 'header lookalike not escaped');
+
+  // Partial reads/writes can't see through the codec
+  assert.throws(function() {
+    db.getRange({key: new Buffer('big'), offset: 0, length: 4},
+                function(res, data) {});
+  });
+  assert.throws(function() {
+    db.putRange({key: new Buffer('big'), offset: 0, val: new Buffer('b')},
+                function(res) {});
+  });
+
+  // Neither can a secondary's key callback
+  assert.throws(function() {
+    db._associateSync(new BDB.Db(env), lib, 'rle_compress', 0);
+  });
+
+  // And the async paths
+  db.put({key: new Buffer('async'), val: big}, function(res) {
+    assert.equal(0, res.code, res.message);
+    db.get({key: new Buffer('async')}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      assert.ok(sameBytes(big, data), 'async round trip');
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      return callback();
+    });
+  });
+}
+
+function dictionary(callback) {
+  var samples = [];
+  for (var i = 0; i < 20; i++)
+    samples.push(new Buffer('{"type":"user","id":' + i + '}'));
+
+  var db = new BDB.Db(env);
+  var dict = db.trainCodec({lib: lib, prefix: 'rle', samples: samples});
+  assert.ok(Buffer.isBuffer(dict), 'no dictionary');
+  assert.equal('{"type":"user","id":', dict.toString(encoding='utf8'));
+
+  // With the dictionary, values past minSize that only share the prefix
+  // compress too
+  db = openCodec(dict);
+  var val = new Buffer('{"type":"user","id":12345}');
+  roundTrip(db, 'user', val);
+  var raw = stored('user');
+  assert.ok(tagged(raw), 'user value not compressed');
+  assert.ok(raw.length < val.length);
+  stat = db.closeSync();
+  assert.equal(0, stat.code, stat.message);
+  return callback();
+}
+
+exec('cc -shared -fPIC -o ' + lib + ' test/codec_rle.c',
+     function(err, stdout, stderr) {
+  assert.ok(!err, 'building codec_rle.c: ' + stderr);
+  writeLegacy();
+  basics(function() {
+    dictionary(function() {
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+      console.log('test_codec: PASSED');
+    });
+  });
+});
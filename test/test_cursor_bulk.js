@@ -0,0 +1,50 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var RECORDS = 500;
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var records = [];
+var expected = {};
+for (var i = 0; i < RECORDS; i++) {
+  records.push({key: new Buffer(helper.uuid()), val: new Buffer(helper.uuid())});
+  expected[records[i].key.toString()] = records[i].val.toString();
+}
+
+db.putMany(records, function(res) {
+  assert.equal(0, res.code, res.message);
+  db.cursorGet({initFlag: BDB.FLAGS.DB_FIRST,
+                limit: RECORDS * 2,
+                bulk: true,
+                bufferSize: 4096}, function(res, data, offsets) {
+    assert.equal(BDB.FLAGS.DB_NOTFOUND, res.code, res.message);
+    assert.equal(RECORDS * 4, offsets.length);
+    var last;
+    for (var i = 0; i < offsets.length; i += 4) {
+      var k = data.slice(offsets[i], offsets[i] + offsets[i + 1]).toString();
+      var v = data.slice(offsets[i + 2], offsets[i + 2] + offsets[i + 3]);
+      assert.equal(expected[k], v.toString(), 'val mismatch');
+      if (last) {
+        assert.ok(last < k, 'keys out of order');
+      }
+      last = k;
+    }
+    exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    console.log('test_cursor_bulk: PASSED');
+  });
+});
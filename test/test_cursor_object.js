@@ -0,0 +1,52 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var records = [];
+for (var i = 0; i < 10; i++) {
+  records.push({key: new Buffer('key0' + i), val: new Buffer('val0' + i)});
+}
+
+db.putMany(records, function(res) {
+  assert.equal(0, res.code, res.message);
+  var cursor = db.cursor();
+  cursor.seek(new Buffer('key03'), function(res, recs) {
+    assert.equal(0, res.code, res.message);
+    assert.equal(1, recs.length);
+    assert.equal('key03', recs[0].key.toString());
+    assert.equal('val03', recs[0].value.toString());
+    cursor.next(3, function(res, recs) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(3, recs.length);
+      assert.equal('key06', recs[2].key.toString());
+      cursor.prev(function(res, recs) {
+        assert.equal(0, res.code, res.message);
+        assert.equal('key05', recs[0].key.toString());
+        cursor.next(100, function(res, recs) {
+          assert.equal(BDB.FLAGS.DB_NOTFOUND, res.code, res.message);
+          assert.equal(4, recs.length);
+          stat = cursor.closeSync();
+          assert.equal(0, stat.code, stat.message);
+          exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+          console.log('test_cursor_object: PASSED');
+        });
+      });
+    });
+  });
+});
@@ -0,0 +1,52 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var pool = new BDB.BufferPool({size: 64, max: 2});
+var key = new Buffer(helper.uuid());
+var val = new Buffer(helper.uuid());
+
+stat = db.putSync({key: key, val: val});
+assert.equal(0, stat.code, stat.message);
+
+var buf = pool.acquire();
+assert.equal(64, buf.length);
+db.getInto({key: key, buffer: buf}, function(res, length) {
+  assert.equal(0, res.code, res.message);
+  assert.equal(val.length, length);
+  assert.equal(val.toString(encoding='utf8'),
+               buf.slice(0, length).toString(encoding='utf8'),
+               'Data mismatch');
+  pool.release(buf);
+  // Same Buffer comes right back
+  assert.strictEqual(buf, pool.acquire());
+
+  // Too small: nothing written, and we're told what it would take
+  db.getInto({key: key, buffer: new Buffer(4)}, function(res, length) {
+    assert.equal(BDB.FLAGS.DB_BUFFER_SMALL, res.code);
+    assert.equal(val.length, length);
+
+    db.getInto({key: new Buffer(helper.uuid()), buffer: buf},
+               function(res, length) {
+      assert.equal(BDB.FLAGS.DB_NOTFOUND, res.code);
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+      console.log('test_get_into: PASSED');
+    });
+  });
+});
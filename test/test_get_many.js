@@ -0,0 +1,47 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var RECORDS = 100;
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var records = [];
+var keys = [];
+for (var i = 0; i < RECORDS; i++) {
+  records.push({key: new Buffer(helper.uuid()), val: new Buffer(helper.uuid())});
+  keys.push(records[i].key);
+}
+// One key that isn't there
+keys.push(new Buffer(helper.uuid()));
+
+db.putMany(records, function(res) {
+  assert.equal(0, res.code, res.message);
+  db.getMany(keys, {buffer: new Buffer(16)}, function(res, data, offsets) {
+    assert.equal(0, res.code, res.message);
+    assert.ok(data, 'no data from getMany');
+    assert.equal(keys.length * 2, offsets.length);
+    for (var i = 0; i < RECORDS; i++) {
+      var val = data.slice(offsets[i * 2], offsets[i * 2] + offsets[i * 2 + 1]);
+      assert.equal(records[i].val.toString(encoding='utf8'),
+                   val.toString(encoding='utf8'),
+                   'Data mismatch');
+    }
+    assert.equal(-1, offsets[RECORDS * 2 + 1], 'missing key found');
+    exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    console.log('test_get_many: PASSED');
+  });
+});
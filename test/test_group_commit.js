@@ -0,0 +1,95 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 500;
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var file = helper.uuid();
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: file});
+assert.equal(0, stat.code, stat.message);
+
+db.setGroupCommit({maxOps: 32, window: 2000});
+
+var dup = new Buffer(helper.uuid());
+var keys = [];
+var finished = 0;
+var keyExists = 0;
+
+function done() {
+  if (++finished < ITERATIONS + 2)
+    return;
+
+  // Exactly one of the two DB_NOOVERWRITE puts of the same key loses
+  assert.equal(1, keyExists);
+  for (var i = 0; i < keys.length; i++) {
+    var got = db.getSync({key: keys[i]});
+    assert.equal(0, got.code, got.message);
+  }
+  closeWithPending();
+}
+
+// Puts still waiting out the window when the db is closed are written by
+// the close, and their callbacks say so truthfully
+function closeWithPending() {
+  var COUNT = 10;
+  var pending = [];
+  var answered = 0;
+  db.setGroupCommit({maxOps: 1000, window: 10000000});
+  for (var i = 0; i < COUNT; i++) {
+    var key = new Buffer(helper.uuid());
+    pending.push(key);
+    db.put({key: key, val: key}, function(res) {
+      assert.equal(0, res.code, res.message);
+      if (++answered < COUNT)
+        return;
+
+      db = new BDB.Db(env);
+      stat = db.openSync({env: env, file: file});
+      assert.equal(0, stat.code, stat.message);
+      for (var j = 0; j < COUNT; j++)
+        assert.equal(0, db.getSync({key: pending[j]}).code, 'put was lost');
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+      console.log('test_group_commit: PASSED');
+    });
+  }
+  assert.equal(0, answered, 'callbacks ran inside closeSync()');
+  stat = db.closeSync();
+  assert.equal(0, stat.code, stat.message);
+}
+
+for (var i = 0; i < ITERATIONS; i++) {
+  var key = new Buffer(helper.uuid());
+  keys.push(key);
+  db.put({key: key, val: new Buffer(helper.uuid())}, function(res) {
+    assert.equal(0, res.code, res.message);
+    done();
+  });
+}
+
+for (var j = 0; j < 2; j++) {
+  db.put({key: dup, val: dup, flags: BDB.FLAGS.DB_NOOVERWRITE},
+         function(res) {
+    if (res.code === BDB.FLAGS.DB_KEYEXIST) {
+      keyExists++;
+    } else {
+      assert.equal(0, res.code, res.message);
+    }
+    done();
+  });
+}
@@ -0,0 +1,55 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 100;
+
+// Neither a home nor a file; nothing should show up on disk
+var before = fs.readdirSync('.').sort();
+
+var env = new bdb.DbEnv();
+var stat = env.openSync({inMemory: true, logBufferSize: 4 * 1024 * 1024});
+assert.equal(0, stat.code, stat.message);
+
+var db = new bdb.Db(env);
+assert.throws(function() { db.openSync({}); });
+stat = db.openSync({inMemory: true});
+assert.equal(0, stat.code, stat.message);
+
+var key = new Buffer(helper.uuid());
+var val = new Buffer(helper.uuid());
+stat = db.putSync({key: key, val: val});
+assert.equal(0, stat.code, stat.message);
+var res = db.getSync({key: key});
+assert.equal(0, res.code, res.message);
+assert.equal(val, res.value.toString(encoding='utf8'), 'Data mismatch');
+
+// Transactions still work against the in-memory log
+var txn = env.txnBegin();
+var finished = 0;
+for (var i = 0; i < ITERATIONS; i++) {
+  db.put({txn: txn, key: new Buffer('k' + i), val: val}, function(res) {
+    assert.equal(0, res.code, res.message);
+    if (++finished < ITERATIONS)
+      return;
+
+    txn.abort(function(res) {
+      assert.equal(0, res.code, res.message);
+      db.get({key: new Buffer('k0')}, function(res, data) {
+        assert.equal(bdb.FLAGS.DB_NOTFOUND, res.code, 'Abort was ignored');
+
+        stat = db.closeSync();
+        assert.equal(0, stat.code, stat.message);
+        stat = env.closeSync();
+        assert.equal(0, stat.code, stat.message);
+        assert.deepEqual(before, fs.readdirSync('.').sort());
+        console.log('test_in_memory: PASSED');
+      });
+    });
+  });
+}
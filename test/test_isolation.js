@@ -0,0 +1,74 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid(), readUncommitted: true});
+assert.equal(0, stat.code, stat.message);
+
+assert.throws(function() {
+  db.getSync({key: new Buffer('x'), isolation: 'serializable'});
+});
+
+var key = new Buffer(helper.uuid());
+var v1 = helper.uuid();
+var v2 = helper.uuid();
+
+stat = db.putSync({key: key, val: new Buffer(v1)});
+assert.equal(0, stat.code, stat.message);
+
+// Committed reads, outside of any txn
+stat = db.getSync({key: key, isolation: 'committed'});
+assert.equal(0, stat.code, stat.message);
+assert.equal(v1, stat.value.toString(encoding='utf8'));
+
+var txn = env.txnBegin();
+db.put({key: key, val: new Buffer(v2), txn: txn}, function(res) {
+  assert.equal(0, res.code, res.message);
+
+  // Dirty reads see the write in progress, and don't wait for it
+  db.get({key: key, isolation: 'uncommitted'}, function(res, data) {
+    assert.equal(0, res.code, res.message);
+    assert.equal(v2, data.toString(encoding='utf8'));
+
+    db.getMany([key], {isolation: 'uncommitted'}, function(res, data, offsets) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(v2, data.slice(offsets[0], offsets[0] + offsets[1])
+                   .toString(encoding='utf8'));
+
+      var opts = {key: key, limit: 1, isolation: 'uncommitted'};
+      db.cursorGet(opts, function(res, records) {
+        assert.equal(0, res.code, res.message);
+        assert.equal(1, records.length);
+        assert.equal(v2, records[0].value.toString(encoding='utf8'));
+
+        txn.abort(function(res) {
+          assert.equal(0, res.code, res.message);
+          db.get({key: key, isolation: 'committed'}, function(res, data) {
+            assert.equal(0, res.code, res.message);
+            assert.equal(v1, data.toString(encoding='utf8'));
+
+            stat = db.closeSync();
+            assert.equal(0, stat.code, stat.message);
+            stat = env.closeSync();
+            assert.equal(0, stat.code, stat.message);
+            exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+            console.log('test_isolation: PASSED');
+          });
+        });
+      });
+    });
+  });
+});
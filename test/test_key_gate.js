@@ -0,0 +1,72 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 500;
+var KEYS = 4;
+
+var env = new bdb.DbEnv();
+env.setLockDetect(bdb.FLAGS.DB_LOCK_MAXWRITE);
+
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.setThreadPool({threads: 4});
+assert.equal(0, stat.code, stat.message);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+assert.throws(function() { db.setKeyGate({stripes: 0}); });
+db.setKeyGate({stripes: 16, merge: true});
+// Only once
+assert.throws(function() { db.setKeyGate(); });
+
+// Every write lands on a few hot keys; whatever got merged, the last
+// put to each key has to be the value that's left.
+var keys = [];
+var last = [];
+for (var i = 0; i < KEYS; i++) {
+  keys.push(new Buffer(helper.uuid()));
+  last.push(null);
+}
+
+function check() {
+  var checked = 0;
+  keys.forEach(function(key, k) {
+    db.get({key: key}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(last[k], data.toString(encoding='utf8'), 'Not the last put');
+      if (++checked < KEYS)
+        return;
+
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      console.log('test_key_gate: PASSED');
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    });
+  });
+}
+
+var finished = 0;
+for (i = 0; i < ITERATIONS; i++) {
+  var k = i % KEYS;
+  var val = helper.uuid();
+  last[k] = val;
+  db.put({key: keys[k], val: new Buffer(val)}, function(res) {
+    assert.equal(0, res.code, res.message);
+    if (++finished === ITERATIONS)
+      check();
+  });
+}
@@ -0,0 +1,79 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 50;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home: env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var checkHistogram = function(hist, count) {
+  assert.equal(count, hist.count);
+  assert.ok(hist.p50 <= hist.p99);
+  assert.ok(hist.p99 <= hist.p999);
+  assert.ok(hist.p999 <= hist.max);
+};
+
+var run = function(i, callback) {
+  var key = new Buffer('key' + i);
+  db.put({key: key, val: new Buffer('val' + i)}, function(res) {
+    assert.equal(0, res.code, res.message);
+    db.get({key: key}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      db.del({key: key}, function(res) {
+        assert.equal(0, res.code, res.message);
+        callback();
+      });
+    });
+  });
+};
+
+var finished = 0;
+for (var i = 0; i < ITERATIONS; i++) {
+  run(i, function() {
+    if (++finished < ITERATIONS)
+      return;
+
+    // Nothing in there now, so this cursor get ends at DB_NOTFOUND
+    var cursor = db.cursor();
+    cursor.next(function(res, recs) {
+      assert.equal(bdb.FLAGS.DB_NOTFOUND, res.code, res.message);
+      stat = cursor.closeSync();
+      assert.equal(0, stat.code, stat.message);
+
+      stat = db.latencyStats({reset: true});
+      assert.equal(0, stat.code, stat.message);
+      ['get', 'put', 'del'].forEach(function(op) {
+        ['queue', 'exec', 'complete', 'retries'].forEach(function(phase) {
+          checkHistogram(stat[op][phase], ITERATIONS);
+        });
+        assert.ok(stat[op].exec.max > 0);
+      });
+      // The cursor op's completion is recorded just before this callback
+      assert.equal(1, stat.cursor.exec.count);
+
+      stat = db.latencyStats();
+      assert.equal(0, stat.get.exec.count, 'reset did not clear');
+
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+      console.log('test_latency: PASSED');
+    });
+  });
+}
@@ -0,0 +1,64 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 2000;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+var archive_location = env_location + '/archive';
+fs.mkdirSync(env_location, 0750);
+fs.mkdirSync(archive_location, 0750);
+// Small log files, so there's something to archive
+fs.writeFileSync(env_location + '/DB_CONFIG', 'set_lg_max 262144\n');
+var stat = env.openSync({home: env_location});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.startMaintenance({interval: 20,
+                             archive: archive_location,
+                             trickle: 50});
+assert.equal(0, stat.code, stat.message);
+// Only once
+assert.notEqual(0, env.startMaintenance().code);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var val = new Buffer(1024);
+for (var i = 0; i < ITERATIONS; i++) {
+  stat = db.putSync({key: new Buffer('key' + i), val: val});
+  assert.equal(0, stat.code, stat.message);
+}
+
+setTimeout(function() {
+  stat = env.stopMaintenance();
+  assert.equal(0, stat.code, stat.message);
+
+  stat = env.maintenanceStats();
+  assert.equal(0, stat.code, stat.message);
+  ['checkpoint', 'archive', 'trickle'].forEach(function(step) {
+    assert.ok(stat[step].runs > 0, step + ' never ran');
+    assert.equal(0, stat[step].errors, step + ' failed');
+    assert.ok(stat[step].maxUsec >= stat[step].lastUsec);
+    assert.ok(stat[step].totalUsec >= stat[step].maxUsec);
+  });
+
+  var archived = fs.readdirSync(archive_location).filter(function(f) {
+    return /^log\./.test(f);
+  });
+  assert.ok(archived.length > 0, 'no logs archived');
+
+  stat = db.closeSync();
+  assert.equal(0, stat.code, stat.message);
+  stat = env.closeSync();
+  assert.equal(0, stat.code, stat.message);
+  exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+  console.log('test_maintenance: PASSED');
+}, 500);
@@ -1,5 +1,6 @@
 // Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
 var assert = require('assert');
+var Buffer = require('buffer').Buffer;
 var exec  = require('child_process').exec;
 var fs = require('fs');
 var BDB = require('bdb');
@@ -18,6 +19,48 @@ assert.equal(0, stat.code, stat.message);
 var db = new BDB.Db(env);
 stat = db.openSync({file: helper.uuid()});
 assert.equal(0, stat.code, stat.message);
+
+// Prefix-compressed btree with its own page size
+var cdb = new BDB.Db(env);
+stat = cdb.openSync({file: helper.uuid(), pageSize: 8192, minKey: 4,
+                     compress: true});
+assert.equal(0, stat.code, stat.message);
+stat = cdb.putSync({key: new Buffer('tenant/1/entity/1'),
+                    val: new Buffer('a')});
+assert.equal(0, stat.code, stat.message);
+stat = cdb.putSync({key: new Buffer('tenant/1/entity/2'),
+                    val: new Buffer('b')});
+assert.equal(0, stat.code, stat.message);
+stat = cdb.getSync({key: new Buffer('tenant/1/entity/2')});
+assert.equal(0, stat.code, stat.message);
+assert.equal('b', stat.value.toString(encoding='utf8'));
+
+// Pre-sized hash table on the word-at-a-time hash; reopening has to use
+// the same hash to find anything
+var file = helper.uuid();
+var hdb = new BDB.Db(env);
+var options = {file: file, type: BDB.FLAGS.DB_HASH, ffactor: 32,
+               nelem: 1000, hash: true};
+stat = hdb.openSync(options);
+assert.equal(0, stat.code, stat.message);
+for (var i = 0; i < 1000; i++) {
+  stat = hdb.putSync({key: new Buffer('key' + i), val: new Buffer('' + i)});
+  assert.equal(0, stat.code, stat.message);
+}
+stat = hdb.closeSync();
+assert.equal(0, stat.code, stat.message);
+hdb = new BDB.Db(env);
+stat = hdb.openSync(options);
+assert.equal(0, stat.code, stat.message);
+for (i = 0; i < 1000; i++) {
+  stat = hdb.getSync({key: new Buffer('key' + i)});
+  assert.equal(0, stat.code, stat.message);
+  assert.equal('' + i, stat.value.toString(encoding='utf8'));
+}
+
+// Bad settings are reported, not ignored
+var bad = new BDB.Db(env);
+assert.notEqual(0, bad.openSync({file: helper.uuid(), pageSize: 1000}).code);
 exec("rm -fr " + env_location, function(err, stdout, stderr) {});
 
 console.log('test_open: PASSED');
@@ -22,6 +22,14 @@ var key = new Buffer(helper.uuid());
 var val = new Buffer(helper.uuid());
 db.put({key: key, val: val}, function(res) {
   assert.equal(0, res.code, res.message);
-  exec("rm -fr " + env_location, function(err, stdout, stderr) {});
-  console.log('test_put: PASSED');
+
+  // Success statuses are shared, so they're frozen
+  assert.ok(Object.isFrozen(res));
+  res.key = key;
+  db.put({key: key, val: val}, function(res) {
+    assert.equal(0, res.code, res.message);
+    assert.equal(undefined, res.key, 'status leaked a property');
+    exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    console.log('test_put: PASSED');
+  });
 });
@@ -0,0 +1,51 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var RECORDS = 100;
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var records = [];
+for (var i = 0; i < RECORDS; i++) {
+  records.push({key: new Buffer(helper.uuid()), val: new Buffer(helper.uuid())});
+}
+
+db.putMany(records, function(res, codes) {
+  assert.equal(0, res.code, res.message);
+  assert.ok(!codes, 'unexpected per-record codes');
+  for (var i = 0; i < RECORDS; i++) {
+    var got = db.getSync({key: records[i].key});
+    assert.equal(0, got.code, got.message);
+    assert.equal(records[i].val.toString(encoding='utf8'),
+                 got.value.toString(encoding='utf8'),
+                 'Data mismatch');
+  }
+
+  // Second pass: one existing key, one new one
+  var again = [records[0], {key: new Buffer(helper.uuid()),
+                            val: new Buffer(helper.uuid())}];
+  db.putMany(again, {perRecord: true, flags: BDB.FLAGS.DB_NOOVERWRITE},
+             function(res, codes) {
+    assert.equal(0, res.code, res.message);
+    assert.ok(codes, 'no per-record codes');
+    assert.equal(2, codes.length);
+    assert.equal(BDB.FLAGS.DB_KEYEXIST, codes[0]);
+    assert.equal(0, codes[1]);
+    exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    console.log('test_put_many: PASSED');
+  });
+});
@@ -0,0 +1,65 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var SIZE = 256 * 1024;
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var key = new Buffer(helper.uuid());
+var val = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++)
+  val[i] = i % 251;
+
+stat = db.putSync({key: key, val: val});
+assert.equal(0, stat.code, stat.message);
+
+// The "header"
+db.getRange({key: key, offset: 0, length: 16}, function(res, data) {
+  assert.equal(0, res.code, res.message);
+  assert.equal(16, data.length);
+  for (var i = 0; i < 16; i++)
+    assert.equal(val[i], data[i]);
+
+  // Append, then overwrite a few bytes in the middle
+  var tail = new Buffer('appended');
+  db.putRange({key: key, offset: SIZE, val: tail}, function(res) {
+    assert.equal(0, res.code, res.message);
+    db.putRange({key: key, offset: 1000, val: new Buffer('xyz')},
+                function(res) {
+      assert.equal(0, res.code, res.message);
+
+      var got = db.getSync({key: key});
+      assert.equal(0, got.code, got.message);
+      assert.equal(SIZE + tail.length, got.value.length);
+      assert.equal('appended',
+                   got.value.slice(SIZE).toString(encoding='utf8'));
+      assert.equal('xyz',
+                   got.value.slice(1000, 1003).toString(encoding='utf8'));
+      assert.equal(val[999], got.value[999]);
+      assert.equal(val[1003], got.value[1003]);
+
+      // Reading off the end just comes back short
+      db.getRange({key: key, offset: SIZE + 4, length: 100},
+                  function(res, data) {
+        assert.equal(0, res.code, res.message);
+        assert.equal('nded', data.toString(encoding='utf8'));
+        exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+        console.log('test_range: PASSED');
+      });
+    });
+  });
+});
@@ -0,0 +1,168 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 500;
+var KEYS = 8;
+var FILL = 200;
+
+// The youngest locker loses a deadlock, which is always the auto-commit
+// batch below (it begins after the caller's txn)
+var env = new bdb.DbEnv();
+env.setLockDetect(bdb.FLAGS.DB_LOCK_YOUNGEST);
+env.setMaxLockers(ITERATIONS * 6 + 1);
+env.setMaxLockObjects(ITERATIONS * 6 + 1);
+
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.setThreadPool({threads: 4});
+assert.equal(0, stat.code, stat.message);
+
+// Small pages, so the first and last keys land on different (and
+// separately locked) leaf pages
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid(), pageSize: 512});
+assert.equal(0, stat.code, stat.message);
+
+assert.throws(function() { db.setRetryPolicy({base: -1}); });
+db.setRetryPolicy({retries: 50, base: 100000, max: 200000, defer: true});
+
+stat = db.retryStats();
+assert.equal(0, stat.code, stat.message);
+assert.equal(0, stat.retries);
+assert.equal(0, stat.giveUps);
+
+var val = new Buffer(64);
+for (var i = 0; i < FILL; i++) {
+  var k = new Buffer('key-' + (1000 + i));
+  stat = db.putSync({key: k, val: val});
+  assert.equal(0, stat.code, stat.message);
+}
+var first = new Buffer('key-1000');
+var last = new Buffer('key-' + (1000 + FILL - 1));
+
+// A txn locks the first key; an auto-commit op (the loser) locks the last
+// key's page and waits on the first; then the txn goes for the last key.
+// The loser is killed and, if the policy allows, retried after the txn
+// commits.  check() gets the loser's results and the retry counters.
+function deadlock(loser, check, callback) {
+  var before = db.retryStats();
+  var txn = env.txnBegin();
+  var pending = 2;
+  var done = function() {
+    if (--pending === 0)
+      callback();
+  };
+
+  db.put({key: first, val: val, txn: txn}, function(res) {
+    assert.equal(0, res.code, res.message);
+
+    loser(function(res, data) {
+      var stat = db.retryStats();
+      assert.equal(0, stat.code, stat.message);
+      check(res, data, stat.retries - before.retries,
+            stat.giveUps - before.giveUps);
+      done();
+    });
+
+    // Give the loser time to block on the first key
+    setTimeout(function() {
+      db.put({key: last, val: val, txn: txn}, function(res) {
+        assert.equal(0, res.code, res.message);
+        txn.commit(function(res) {
+          assert.equal(0, res.code, res.message);
+          done();
+        });
+      });
+    }, 200);
+  });
+}
+
+// Writes the last key, then the first
+function batch(callback) {
+  db.putMany([{key: last, val: val}, {key: first, val: val}], callback);
+}
+
+// Reads every key from the last back to the first, holding read locks
+function scan(callback) {
+  db.cursorGet({key: last, limit: FILL, flags: bdb.FLAGS.DB_PREV}, callback);
+}
+
+function retried(res, data, retries, giveUps) {
+  assert.equal(0, res.code, res.message);
+  assert.ok(retries > 0, 'loser was not retried');
+  assert.equal(0, giveUps);
+}
+
+function gaveUp(res, data, retries, giveUps) {
+  assert.equal(bdb.FLAGS.DB_LOCK_DEADLOCK, res.code, res.message);
+  assert.equal(0, retries);
+  assert.equal(1, giveUps);
+}
+
+// A handful of hot keys, so the workers keep running into each other
+var keys = [];
+for (i = 0; i < KEYS; i++)
+  keys.push(new Buffer(helper.uuid()));
+
+var run = function(i, callback) {
+  var key = keys[i % KEYS];
+  var val = new Buffer(helper.uuid());
+
+  db.put({key: key, val: val}, function(res) {
+    assert.equal(0, res.code, res.message);
+    db.del({key: key}, function(res) {
+      if (res.code !== bdb.FLAGS.DB_NOTFOUND)
+        assert.equal(0, res.code, res.message);
+      callback();
+    });
+  });
+};
+
+function contention(giveUps) {
+  var finished = 0;
+  db.setRetryPolicy({retries: 50, base: 100, max: 5000, defer: true});
+  for (i = 0; i < ITERATIONS; i++) {
+    run(i, function() {
+      if (++finished < ITERATIONS)
+        return;
+
+      stat = db.retryStats();
+      assert.equal(0, stat.code, stat.message);
+      assert.equal(giveUps, stat.giveUps);
+
+      stat = db.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      console.log('test_retry: PASSED');
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    });
+  }
+}
+
+deadlock(batch, retried, function() {
+  // A retried scan has to come back with each record once, not with what
+  // the killed attempt had read as well
+  deadlock(scan, function(res, records, retries, giveUps) {
+    retried(res, records, retries, giveUps);
+    assert.equal(FILL, records.length);
+    for (var i = 0; i < FILL; i++)
+      assert.equal('key-' + (1000 + FILL - 1 - i), records[i].key.toString());
+  }, function() {
+    // With no retries left, the loser gives up and says so
+    db.setRetryPolicy({retries: 0});
+    deadlock(batch, gaveUp, function() {
+      contention(db.retryStats().giveUps);
+    });
+  });
+});
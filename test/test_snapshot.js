@@ -0,0 +1,63 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid(), snapshot: true});
+assert.equal(0, stat.code, stat.message);
+
+var key = new Buffer(helper.uuid());
+var v1 = helper.uuid();
+var v2 = helper.uuid();
+
+stat = db.putSync({key: key, val: new Buffer(v1)});
+assert.equal(0, stat.code, stat.message);
+
+// A writer holds the key...
+var txn = env.txnBegin();
+db.put({key: key, val: new Buffer(v2), txn: txn}, function(res) {
+  assert.equal(0, res.code, res.message);
+
+  // ...but snapshot readers don't wait for it, and see what was committed
+  var got = db.getSync({key: key});
+  assert.equal(0, got.code, got.message);
+  assert.equal(v1, got.value.toString(encoding='utf8'));
+
+  db.get({key: key}, function(res, data) {
+    assert.equal(0, res.code, res.message);
+    assert.equal(v1, data.toString(encoding='utf8'));
+
+    db.cursorGet({key: key, limit: 1}, function(res, records) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(1, records.length);
+      assert.equal(v1, records[0].value.toString(encoding='utf8'));
+
+      txn.commit(function(res) {
+        assert.equal(0, res.code, res.message);
+        db.get({key: key, snapshot: true}, function(res, data) {
+          assert.equal(0, res.code, res.message);
+          assert.equal(v2, data.toString(encoding='utf8'));
+
+          stat = db.closeSync();
+          assert.equal(0, stat.code, stat.message);
+          stat = env.closeSync();
+          assert.equal(0, stat.code, stat.message);
+          exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+          console.log('test_snapshot: PASSED');
+        });
+      });
+    });
+  });
+});
@@ -0,0 +1,72 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 100;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home: env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+for (var i = 0; i < ITERATIONS; i++) {
+  stat = db.putSync({key: new Buffer('key' + i), val: new Buffer('val' + i)});
+  assert.equal(0, stat.code, stat.message);
+}
+
+var checkNumbers = function(obj) {
+  Object.keys(obj).forEach(function(k) {
+    assert.equal('number', typeof(obj[k]), k + ' is not a number');
+  });
+};
+
+env.stats(null, function(res, stats) {
+  assert.equal(0, res.code, res.message);
+  ['mpool', 'lock', 'log', 'txn', 'mutex'].forEach(function(name) {
+    assert.ok(stats[name], 'missing ' + name);
+    checkNumbers(stats[name]);
+  });
+  assert.ok(stats.txn.ncommits >= ITERATIONS);
+  assert.ok(stats.log.record > 0);
+
+  env.stats({txn: true, reset: true}, function(res, stats) {
+    assert.equal(0, res.code, res.message);
+    assert.ok(stats.txn);
+    assert.ok(!stats.mpool);
+
+    env.stats({txn: true}, function(res, stats) {
+      assert.equal(0, res.code, res.message);
+      assert.ok(stats.txn.ncommits < ITERATIONS, 'counters not reset');
+
+      db.stats(null, function(res, stats) {
+        assert.equal(0, res.code, res.message);
+        checkNumbers(stats);
+        assert.equal(ITERATIONS, stats.nkeys);
+        assert.ok(stats.leafPg > 0);
+
+        db.stats({fast: true}, function(res, stats) {
+          assert.equal(0, res.code, res.message);
+          assert.ok(stats.pagesize > 0);
+
+          stat = db.closeSync();
+          assert.equal(0, stat.code, stat.message);
+          stat = env.closeSync();
+          assert.equal(0, stat.code, stat.message);
+          exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+          console.log('test_stats: PASSED');
+        });
+      });
+    });
+  });
+});
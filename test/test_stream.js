@@ -0,0 +1,66 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var records = [];
+for (var i = 10; i < 60; i++) {
+  records.push({key: new Buffer('key' + i), val: new Buffer('val' + i)});
+}
+
+var checkRange = function(options, expected, callback) {
+  var seen = [];
+  var stream = db.createReadStream(options);
+  stream.on('data', function(record) {
+    seen.push(record.key.toString());
+    assert.equal(record.key.toString().replace('key', 'val'),
+                 record.value.toString(), 'val mismatch');
+    // Exercise backpressure
+    if (seen.length % 4 === 0) {
+      stream.pause();
+      setTimeout(function() { stream.resume(); }, 1);
+    }
+  });
+  stream.on('error', function(err) {
+    assert.ok(false, err.message);
+  });
+  stream.on('end', function() {
+    assert.deepEqual(expected, seen);
+    callback();
+  });
+};
+
+db.putMany(records, function(res) {
+  assert.equal(0, res.code, res.message);
+  var forward = [];
+  for (var i = 20; i < 30; i++) {
+    forward.push('key' + i);
+  }
+  checkRange({gte: new Buffer('key20'), lt: new Buffer('key30'), batchSize: 3},
+             forward, function() {
+    checkRange({gte: new Buffer('key20'), lt: new Buffer('key30'),
+                batchSize: 3, reverse: true},
+               forward.slice().reverse(), function() {
+      checkRange({gte: new Buffer('key58'), reverse: true},
+                 ['key59', 'key58'], function() {
+        exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+        console.log('test_stream: PASSED');
+      });
+    });
+  });
+});
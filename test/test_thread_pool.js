@@ -0,0 +1,71 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 500;
+
+var env = new bdb.DbEnv();
+env.setLockDetect(bdb.FLAGS.DB_LOCK_MAXWRITE);
+env.setMaxLockers(ITERATIONS * 6 + 1);
+env.setMaxLockObjects(ITERATIONS * 6 + 1);
+
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+stat = env.setThreadPool({threads: 3});
+assert.equal(0, stat.code, stat.message);
+// Only once
+assert.notEqual(0, env.setThreadPool({threads: 3}).code);
+
+// Two databases, so the pool has two queues to take turns between
+var dbs = [new bdb.Db(env), new bdb.Db(env)];
+dbs.forEach(function(db) {
+  stat = db.openSync({file: helper.uuid(), retries: 4});
+  assert.equal(0, stat.code, stat.message);
+});
+
+var run = function(db, callback) {
+  var key = new Buffer(helper.uuid());
+  var val = new Buffer(helper.uuid());
+
+  db.put({key: key, val: val}, function(res) {
+    assert.equal(0, res.code, res.message);
+    db.get({key: key}, function(res, data) {
+      assert.equal(0, res.code, res.message);
+      assert.ok(data, "no data from get");
+      assert.equal(val, data.toString(encoding='utf8'), 'Data mismatch');
+      db.del({key: key}, function(res) {
+        assert.equal(0, res.code, res.message);
+        callback();
+      });
+    });
+  });
+};
+
+var finished = 0;
+for (var i = 0; i < ITERATIONS; i++) {
+  run(dbs[i % 2], function() {
+    if (++finished < ITERATIONS)
+      return;
+
+    env.txnCheckpoint(null, function(res) {
+      assert.equal(0, res.code, res.message);
+      dbs.forEach(function(db) {
+        stat = db.closeSync();
+        assert.equal(0, stat.code, stat.message);
+      });
+      stat = env.closeSync();
+      assert.equal(0, stat.code, stat.message);
+      exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+      console.log('test_thread_pool: PASSED');
+    });
+  });
+}
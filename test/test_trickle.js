@@ -0,0 +1,84 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+
+var bdb = require('bdb');
+var helper = require('./helper');
+
+// setup
+var ITERATIONS = 2000;
+// The cache's page size, which is what the rate is counted in
+var PAGE_SIZE = 4096;
+
+var env = new bdb.DbEnv();
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+var stat = env.openSync({home: env_location, cacheSize: 4 * 1024 * 1024});
+assert.equal(0, stat.code, stat.message);
+
+assert.notEqual(0, env.startTrickle({percent: 101}).code);
+stat = env.startTrickle({percent: 90, rate: 1024 * 1024, interval: 20});
+assert.equal(0, stat.code, stat.message);
+// Only once
+assert.notEqual(0, env.startTrickle().code);
+
+var db = new bdb.Db(env);
+stat = db.openSync({file: helper.uuid(), pageSize: PAGE_SIZE});
+assert.equal(0, stat.code, stat.message);
+
+var val = new Buffer(1024);
+for (var i = 0; i < ITERATIONS; i++) {
+  stat = db.putSync({key: new Buffer('key' + i), val: val});
+  assert.equal(0, stat.code, stat.message);
+}
+
+setTimeout(function() {
+  stat = env.trickleStats();
+  assert.equal(0, stat.code, stat.message);
+  assert.ok(stat.runs > 0, 'trickle never ran');
+  assert.ok(stat.pagesWritten > 0, 'trickle wrote nothing');
+
+  stat = env.stopTrickle();
+  assert.equal(0, stat.code, stat.message);
+  var runs = env.trickleStats().runs;
+
+  setTimeout(function() {
+    assert.equal(runs, env.trickleStats().runs);
+    throttle();
+  }, 100);
+}, 500);
+
+// Dirty the cache again and trickle under a budget well below a page per
+// pass: what's written has to stay within rate * elapsed, and the unused
+// budget has to carry over, or nothing would ever be written
+function throttle() {
+  var RATE = 128 * 1024;
+  for (var i = 0; i < ITERATIONS; i++) {
+    stat = db.putSync({key: new Buffer('key' + i), val: val});
+    assert.equal(0, stat.code, stat.message);
+  }
+
+  var before = env.trickleStats().pagesWritten;
+  var started = Date.now();
+  stat = env.startTrickle({percent: 90, rate: RATE, interval: 20});
+  assert.equal(0, stat.code, stat.message);
+
+  setTimeout(function() {
+    stat = env.trickleStats();
+    var elapsed = Date.now() - started;
+    var written = (stat.pagesWritten - before) * PAGE_SIZE;
+    assert.ok(written > 0, 'throttled trickle wrote nothing');
+    assert.ok(written <= RATE * elapsed / 1000,
+              written + ' bytes in ' + elapsed + 'ms');
+    assert.ok(stat.throttled > 0);
+
+    stat = db.closeSync();
+    assert.equal(0, stat.code, stat.message);
+    stat = env.closeSync();
+    assert.equal(0, stat.code, stat.message);
+    exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+    console.log('test_trickle: PASSED');
+  }, 1500);
+}
@@ -0,0 +1,80 @@
+// Copyright 2011 Mark Cavage <mcavage@gmail.com> All rights reserved.
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+var exec  = require('child_process').exec;
+var fs = require('fs');
+var BDB = require('bdb');
+var helper = require('./helper');
+
+// setup
+var env_location = "/tmp/" + helper.uuid();
+fs.mkdirSync(env_location, 0750);
+
+var env = new BDB.DbEnv();
+var stat = env.openSync({home:env_location});
+assert.equal(0, stat.code, stat.message);
+
+var db = new BDB.Db(env);
+stat = db.openSync({env: env, file: helper.uuid()});
+assert.equal(0, stat.code, stat.message);
+
+var k1 = new Buffer(helper.uuid());
+var k2 = new Buffer(helper.uuid());
+var k3 = new Buffer(helper.uuid());
+var val = new Buffer(helper.uuid());
+
+// A Txn can't be resolved under an open cursor, nor a parent under its
+// child's; and resolving a parent resolves the child
+function cursors() {
+  var parent = env.txnBegin();
+  var child = env.txnBegin({parent: parent});
+  var cursor = db.cursor({txn: child});
+  parent.commit(function(res) {
+    assert.equal(BDB.FLAGS.EINVAL, res.code, 'committed under a cursor');
+    child.commit(function(res) {
+      assert.equal(BDB.FLAGS.EINVAL, res.code, 'committed under a cursor');
+      assert.equal(0, cursor.closeSync().code);
+      parent.commit(function(res) {
+        assert.equal(0, res.code, res.message);
+        child.abort(function(res) {
+          assert.equal(BDB.FLAGS.EINVAL, res.code, 'child outlived parent');
+          assert.equal(BDB.FLAGS.EINVAL,
+                       db.putSync({key: k3, val: val, txn: child}).code);
+          exec("rm -fr " + env_location, function(err, stdout, stderr) {});
+          console.log('test_txn: PASSED');
+        });
+      });
+    });
+  });
+}
+
+// Two puts in one transaction, committed
+var txn = env.txnBegin();
+db.put({key: k1, val: val, txn: txn}, function(res) {
+  assert.equal(0, res.code, res.message);
+  db.put({key: k2, val: val, txn: txn}, function(res) {
+    assert.equal(0, res.code, res.message);
+    var got = db.getSync({key: k1, txn: txn});
+    assert.equal(0, got.code, got.message);
+    txn.commit(function(res) {
+      assert.equal(0, res.code, res.message);
+      assert.equal(0, db.getSync({key: k1}).code);
+      assert.equal(0, db.getSync({key: k2}).code);
+
+      // A resolved transaction can't be used again
+      assert.equal(BDB.FLAGS.EINVAL,
+                   db.putSync({key: k3, val: val, txn: txn}).code);
+
+      // And one that's aborted leaves nothing behind
+      var txn2 = env.txnBegin();
+      db.put({key: k3, val: val, txn: txn2}, function(res) {
+        assert.equal(0, res.code, res.message);
+        txn2.abort(function(res) {
+          assert.equal(0, res.code, res.message);
+          assert.equal(BDB.FLAGS.DB_NOTFOUND, db.getSync({key: k3}).code);
+          cursors();
+        });
+      });
+    });
+  });
+});